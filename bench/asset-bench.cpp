@@ -0,0 +1,267 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include <stb_image_write.h>
+
+#include <bench-meshes.hpp>
+#include <csv-model.hpp>
+#include <job-system.hpp>
+#include <mesh-tools.hpp>
+#include <settings.hpp>
+#include <texture.hpp>
+
+// synthetic inputs are written once per size to the temp folder and removed
+// when the benchmarks exit
+class BenchFiles
+{
+public:
+    ~BenchFiles()
+    {
+        for (auto& entry: _files)
+            std::filesystem::remove(entry.second);
+    }
+
+    template <typename Write>
+    const std::string& get(const std::string& name, Write&& write)
+    {
+        auto it = _files.find(name);
+
+        if (it != _files.end())
+            return it->second;
+
+        auto path = (std::filesystem::temp_directory_path() / ("opengl-thing-" + name)).string();
+        write(path);
+
+        return _files.emplace(name, path).first->second;
+    }
+
+private:
+    std::map<std::string, std::string> _files;
+};
+
+static BenchFiles bench_files;
+
+// a triangle soup in the same format as the files in res/
+static const std::string& csv_file(std::int64_t vertex_count)
+{
+    return bench_files.get(fmt::format("mesh-{}.csv", vertex_count), [&](const std::string& path) {
+        auto file = std::fopen(path.c_str(), "w");
+
+        for (std::int64_t i = 0; i < vertex_count; i++)
+        {
+            auto x = (float) (i % 1000) * 0.01f;
+            auto y = (float) ((i * 7) % 113) * 0.01f;
+            auto z = (float) (i / 1000) * 0.01f;
+
+            std::fprintf(file,
+                "%.4ff;%.4ff;%.4ff;1.0f;1.0f;1.0f;%.4ff;%.4ff;0.0f;1.0f;0.0f;\n",
+                x, y, z, x, z);
+        }
+
+        std::fclose(file);
+    });
+}
+
+static void BM_ParseCsv(benchmark::State& state)
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    auto& filename = csv_file(state.range(0));
+    auto bytes = std::filesystem::file_size(filename);
+
+    for (auto _: state)
+    {
+        auto mesh = CsvModel::parse_csv(filename);
+        benchmark::DoNotOptimize(mesh.vertices.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+BENCHMARK(BM_ParseCsv)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000)
+    ->Unit(benchmark::kMillisecond);
+
+// range(0) = vertex count, range(1) = 0 for flat, 1 for smooth normals
+static void BM_GenerateNormals(benchmark::State& state)
+{
+    auto vertex_count = static_cast<std::size_t>(state.range(0));
+    auto smooth = state.range(1) == 1;
+
+    JobSystem jobs;
+    auto mesh = grid_mesh(vertex_count);
+
+    for (auto _: state)
+    {
+        generate_normals(jobs, mesh, smooth ? NormalMode::smooth : NormalMode::flat);
+        benchmark::DoNotOptimize(mesh.vertices.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * vertex_count);
+    state.SetLabel(smooth ? "smooth" : "flat");
+    state.counters["threads"] = jobs.thread_count();
+}
+
+BENCHMARK(BM_GenerateNormals)
+    ->ArgsProduct({{1000, 10000, 100000, 1000000, 10000000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+static void BM_ValidateMesh(benchmark::State& state)
+{
+    auto vertex_count = static_cast<std::size_t>(state.range(0));
+    auto mesh = grid_mesh(vertex_count);
+
+    for (auto _: state)
+    {
+        auto report = validate_mesh(mesh);
+        benchmark::DoNotOptimize(report);
+    }
+
+    state.SetItemsProcessed(state.iterations() * vertex_count);
+}
+
+BENCHMARK(BM_ValidateMesh)
+    ->RangeMultiplier(10)
+    ->Range(1000, 10000000)
+    ->Unit(benchmark::kMicrosecond);
+
+// range(0) = number of objects in the file
+static void BM_LoadSettings(benchmark::State& state)
+{
+    spdlog::set_level(spdlog::level::warn);
+
+    auto object_count = state.range(0);
+
+    auto& filename = bench_files.get(fmt::format("settings-{}.json", object_count), [&](const std::string& path) {
+        auto objects = nlohmann::json::array();
+
+        for (std::int64_t i = 0; i < object_count; i++)
+        {
+            objects.push_back({
+                {"model", fmt::format("model-{}.csv", i)},
+                {"texture", fmt::format("texture-{}.jpg", i)},
+                {"position", {(float) i, 0.0f, 0.0f}}
+            });
+        }
+
+        nlohmann::json json =
+        {
+            {"root-folder", "/tmp"},
+            {"vertex-shader", "phong.vert"},
+            {"fragment-shader", "phong.frag"},
+            {"objects", objects},
+            {"sun", {
+                {"model", "box.csv"},
+                {"vertex-shader", "sun.vert"},
+                {"fragment-shader", "sun.frag"}
+            }}
+        };
+
+        auto file = std::fopen(path.c_str(), "w");
+        std::fputs(json.dump(4).c_str(), file);
+        std::fclose(file);
+    });
+
+    for (auto _: state)
+    {
+        auto settings = load_settings(filename);
+        benchmark::DoNotOptimize(settings.objects.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * object_count);
+}
+
+BENCHMARK(BM_LoadSettings)
+    ->RangeMultiplier(8)
+    ->Range(1, 4096)
+    ->Unit(benchmark::kMicrosecond);
+
+// range(0) = image side in pixels, range(1) = 0 for png, 1 for jpg
+static void BM_LoadImage(benchmark::State& state)
+{
+    auto side = static_cast<int>(state.range(0));
+    auto jpg = state.range(1) == 1;
+
+    auto name = fmt::format("image-{}.{}", side, jpg ? "jpg" : "png");
+
+    auto& filename = bench_files.get(name, [&](const std::string& path) {
+        std::vector<unsigned char> pixels(side * side * 3);
+
+        for (int y = 0; y < side; y++)
+        {
+            for (int x = 0; x < side; x++)
+            {
+                auto pixel = &pixels[(y * side + x) * 3];
+                pixel[0] = (unsigned char) (x ^ y);
+                pixel[1] = (unsigned char) (x * 3 + y);
+                pixel[2] = (unsigned char) ((x * y) >> 4);
+            }
+        }
+
+        if (jpg)
+            stbi_write_jpg(path.c_str(), side, side, 3, pixels.data(), 90);
+        else
+            stbi_write_png(path.c_str(), side, side, 3, pixels.data(), side * 3);
+    });
+
+    for (auto _: state)
+    {
+        auto image = load_image(filename);
+        benchmark::DoNotOptimize(image.pixels.get());
+    }
+
+    state.SetItemsProcessed(state.iterations() * side * side);
+    state.SetLabel(jpg ? "jpg" : "png");
+}
+
+BENCHMARK(BM_LoadImage)
+    ->ArgsProduct({{256, 1024, 4096}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+// range(0) = image side in pixels, builds the whole mip chain like the cook
+// tool does
+static void BM_BuildMipChain(benchmark::State& state)
+{
+    auto side = static_cast<int>(state.range(0));
+
+    Image image;
+    image.width = side;
+    image.height = side;
+    image.channels = 3;
+    image.pixels = { static_cast<unsigned char*>(std::malloc(std::size_t(side) * side * 3)), std::free };
+
+    for (std::size_t i = 0; i < std::size_t(side) * side * 3; i++)
+        image.pixels.get()[i] = (unsigned char) (i * 7);
+
+    for (auto _: state)
+    {
+        auto mip = downsample(image);
+
+        while (mip.width > 1 || mip.height > 1)
+            mip = downsample(mip);
+
+        benchmark::DoNotOptimize(mip.pixels.get());
+    }
+
+    state.SetItemsProcessed(state.iterations() * side * side);
+}
+
+BENCHMARK(BM_BuildMipChain)
+    ->Arg(256)
+    ->Arg(1024)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond);
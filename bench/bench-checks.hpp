@@ -0,0 +1,14 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+// benchmarks that also check something, like the frame loop never
+// allocating, fail through here so the bench binary exits with an error and
+// not only a note in the report
+extern bool bench_check_failed;
+
+inline void fail_check(benchmark::State& state, const char* message)
+{
+    state.SkipWithError(message);
+    bench_check_failed = true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include <csv-model.hpp>
+
+// a grid of quads, so every vertex is shared by up to six triangles like
+// in a real mesh
+inline CsvMesh grid_mesh(std::size_t vertex_count)
+{
+    auto quads = vertex_count / 6;
+    auto side = static_cast<std::size_t>(std::sqrt((double) quads)) + 1;
+
+    CsvMesh mesh;
+    mesh.vertices.reserve(quads * 6 * CsvModel::floats_per_vertex);
+
+    for (std::size_t quad = 0; quad < quads; quad++)
+    {
+        auto x = (float) (quad % side);
+        auto z = (float) (quad / side);
+
+        const float corners[6][2] = { {0, 0}, {0, 1}, {1, 1}, {1, 1}, {1, 0}, {0, 0} };
+
+        for (auto& corner: corners)
+        {
+            auto px = x + corner[0];
+            auto pz = z + corner[1];
+            auto py = std::sin(px * 0.3f) * std::cos(pz * 0.2f);
+
+            const float vertex[CsvModel::floats_per_vertex] =
+            {
+                px, py, pz, 1.0f, 1.0f, 1.0f, corner[0], corner[1], 0.0f, 0.0f, 0.0f
+            };
+
+            mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + CsvModel::floats_per_vertex);
+        }
+    }
+
+    return mesh;
+}
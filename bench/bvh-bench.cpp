@@ -0,0 +1,149 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <bench-meshes.hpp>
+#include <bvh.hpp>
+#include <csv-model.hpp>
+#include <job-system.hpp>
+
+constexpr std::size_t rays_per_batch = 4096;
+
+const char* const res_meshes[] = { "box.csv", "casinhatop.csv", "arvoretop.csv" };
+
+static CsvMesh res_mesh(std::int64_t index)
+{
+    spdlog::set_level(spdlog::level::warn);
+    return CsvModel::parse_csv(fmt::format("{}/{}", BENCH_RES_FOLDER, res_meshes[index]));
+}
+
+static CsvMesh synthetic_mesh(std::int64_t triangle_count)
+{
+    auto mesh = grid_mesh(static_cast<std::size_t>(triangle_count) * 3);
+    CsvModel::compute_bounds(mesh);
+    return mesh;
+}
+
+// rays from a sphere around the mesh towards random points inside its
+// bounds, so most of them hit something like a picking ray would
+static std::vector<Ray> random_rays(const Bounds& bounds, std::size_t count)
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> normal;
+
+    auto center = (bounds.min + bounds.max) * 0.5f;
+    auto radius = glm::length(bounds.max - bounds.min);
+
+    std::vector<Ray> rays(count);
+
+    for (auto& ray: rays)
+    {
+        auto around = glm::vec3(normal(random), normal(random), normal(random));
+        auto target = bounds.min + (bounds.max - bounds.min) * glm::vec3(unit(random), unit(random), unit(random));
+
+        ray.origin = center + glm::normalize(around) * radius;
+        ray.direction = glm::normalize(target - ray.origin);
+    }
+
+    return rays;
+}
+
+static void run_rays(benchmark::State& state, const CsvMesh& mesh, bool any_hit)
+{
+    MeshBvh bvh(mesh);
+    auto rays = random_rays(bvh.bounds(), rays_per_batch);
+
+    std::vector<RayHit> hits(rays.size());
+    std::vector<std::uint8_t> occluded(rays.size());
+
+    for (auto _: state)
+    {
+        if (any_hit)
+            bvh.occluded(rays.data(), occluded.data(), rays.size());
+        else
+            bvh.intersect(rays.data(), hits.data(), rays.size());
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * rays.size());
+    state.counters["triangles"] = bvh.triangle_count();
+}
+
+// range(0) = index into res_meshes, range(1) = 0 for closest hit, 1 for any
+static void BM_BvhRaysRes(benchmark::State& state)
+{
+    auto mesh = res_mesh(state.range(0));
+    run_rays(state, mesh, state.range(1) == 1);
+    state.SetLabel(fmt::format("{} {}", res_meshes[state.range(0)], state.range(1) ? "occluded" : "closest"));
+}
+
+BENCHMARK(BM_BvhRaysRes)
+    ->ArgsProduct({{0, 1, 2}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+// range(0) = triangles, range(1) = 0 for closest hit, 1 for any
+static void BM_BvhRaysSynthetic(benchmark::State& state)
+{
+    auto mesh = synthetic_mesh(state.range(0));
+    run_rays(state, mesh, state.range(1) == 1);
+    state.SetLabel(state.range(1) ? "occluded" : "closest");
+}
+
+BENCHMARK(BM_BvhRaysSynthetic)
+    ->ArgsProduct({{1000, 100000, 1000000}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+// the batch split over the workers, rays are independent so this should
+// scale with the cores
+static void BM_BvhRaysParallel(benchmark::State& state)
+{
+    JobSystem jobs;
+
+    auto mesh = synthetic_mesh(state.range(0));
+    MeshBvh bvh(mesh);
+
+    auto rays = random_rays(bvh.bounds(), rays_per_batch * 16);
+    std::vector<RayHit> hits(rays.size());
+
+    for (auto _: state)
+    {
+        jobs.parallel_for(rays.size(), 256, [&](std::size_t begin, std::size_t end) {
+            bvh.intersect(rays.data() + begin, hits.data() + begin, end - begin);
+        });
+
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * rays.size());
+    state.counters["threads"] = jobs.thread_count();
+}
+
+BENCHMARK(BM_BvhRaysParallel)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+static void BM_BuildBvh(benchmark::State& state)
+{
+    auto mesh = synthetic_mesh(state.range(0));
+
+    for (auto _: state)
+    {
+        MeshBvh bvh(mesh);
+        benchmark::DoNotOptimize(bvh.node_count());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_BuildBvh)
+    ->RangeMultiplier(10)
+    ->Range(1000, 1000000)
+    ->Unit(benchmark::kMillisecond);
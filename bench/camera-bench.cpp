@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+
+#include <camera.hpp>
+
+static Camera make_camera()
+{
+    return Camera(
+        glm::vec3(0.0f, 0.0f, 3.0f),
+        glm::vec3(0.0f, 0.0f, -1.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+static void BM_CameraTurn(benchmark::State& state)
+{
+    auto camera = make_camera();
+
+    for (auto _: state)
+    {
+        camera.turn(0.1f, 0.05f);
+        benchmark::DoNotOptimize(camera);
+    }
+}
+
+BENCHMARK(BM_CameraTurn);
+
+static void BM_CameraLookAt(benchmark::State& state)
+{
+    auto camera = make_camera();
+
+    for (auto _: state)
+    {
+        auto view = camera.look_at();
+        benchmark::DoNotOptimize(view);
+    }
+}
+
+BENCHMARK(BM_CameraLookAt);
+
+// what the simulation does every tick while the mouse moves
+static void BM_CameraTurnAndLookAt(benchmark::State& state)
+{
+    auto camera = make_camera();
+
+    for (auto _: state)
+    {
+        camera.turn(0.1f, 0.05f);
+        auto view = camera.look_at();
+        benchmark::DoNotOptimize(view);
+    }
+}
+
+BENCHMARK(BM_CameraTurnAndLookAt);
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <allocation-tracker.hpp>
+#include <bench-checks.hpp>
+#include <bench-meshes.hpp>
+#include <draw-list.hpp>
+#include <frame-arena.hpp>
+#include <job-system.hpp>
+#include <scene.hpp>
+
+// the CPU side of a frame: animating the scene, updating it and culling and
+// sorting it into the draw list. once warm it must not touch the heap, so
+// the bench exits with an error when an iteration allocates.
+// range(0) = entity count
+static void BM_FrameLoop(benchmark::State& state)
+{
+    auto entity_count = static_cast<std::size_t>(state.range(0));
+
+    JobSystem jobs;
+    Scene scene;
+    CsvModel model(grid_mesh(600), nullptr);
+
+    std::vector<Renderable> objects;
+    auto side = static_cast<std::size_t>(std::sqrt((double) entity_count)) + 1;
+
+    for (std::size_t i = 0; i < entity_count; i++)
+    {
+        auto entity = scene.create_entity(no_entity, model.bounds());
+        scene.set_position(entity, glm::vec3((float) (i % side) * 12.0f, 0.0f, (float) (i / side) * -12.0f));
+        objects.push_back(Renderable { entity, &model, ShadingModel::phong });
+    }
+
+    // from one corner of the grid, so part of it is culled
+    auto view = glm::lookAt(glm::vec3(0.0f, 10.0f, 20.0f), glm::vec3(10.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    auto projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+    FrameArena arena;
+    DrawList draw_list;
+    float time = 0.0f;
+
+    auto frame = [&]() {
+        time += 0.016f;
+
+        for (std::size_t i = 0; i < entity_count; i++)
+        {
+            auto angle = time + (float) i * 0.001f;
+            scene.set_rotation((Entity) i, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+
+        scene.update(jobs);
+
+        arena.reset();
+
+        auto renderables = arena.allocate<Renderable>(objects.size());
+        std::copy(objects.begin(), objects.end(), renderables);
+
+        draw_list.build(
+            jobs, arena, scene.world(), scene.world_bounds(),
+            renderables, objects.size(), view, projection);
+
+        benchmark::DoNotOptimize(draw_list.commands());
+    };
+
+    // the first frames size the arena and the buffers of the scene
+    for (int i = 0; i < 3; i++)
+        frame();
+
+    auto before = allocation_counts();
+
+    for (auto _: state)
+        frame();
+
+    auto allocations = allocation_counts().allocations - before.allocations;
+
+    if (allocations > 0)
+        fail_check(state, "the steady state frame loop allocated");
+
+    state.SetItemsProcessed(state.iterations() * entity_count);
+    state.counters["allocations"] = benchmark::Counter((double) allocations, benchmark::Counter::kAvgIterations);
+    state.counters["draws"] = (double) draw_list.size();
+    state.counters["arena KB"] = arena.peak() / 1024.0;
+    state.counters["threads"] = jobs.thread_count();
+}
+
+BENCHMARK(BM_FrameLoop)
+    ->Arg(1 << 10)
+    ->Arg(1 << 14)
+    ->Arg(1 << 17)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
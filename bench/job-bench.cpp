@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <job-system.hpp>
+#include <scene.hpp>
+
+// runs the benchmark once for every thread count from 1 to the core count
+static void thread_counts(benchmark::internal::Benchmark* benchmark)
+{
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+
+    for (int threads = 1; threads <= std::max(cores, 1); threads++)
+        benchmark->Arg(threads);
+}
+
+// arithmetic bound work with no shared state, the ideal scaling case
+static void BM_JobScalingCompute(benchmark::State& state)
+{
+    JobSystem jobs(static_cast<unsigned int>(state.range(0)));
+    std::vector<float> values(1 << 20);
+
+    for (auto _: state)
+    {
+        jobs.parallel_for(values.size(), 4096, [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; i++)
+                values[i] = std::sin((float) i) * std::cos((float) i * 0.5f);
+        });
+
+        benchmark::DoNotOptimize(values.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * values.size());
+    state.counters["threads"] = jobs.thread_count();
+}
+
+BENCHMARK(BM_JobScalingCompute)
+    ->Apply(thread_counts)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// the per frame transform update of a large animated scene
+static void BM_JobScalingTransforms(benchmark::State& state)
+{
+    constexpr std::size_t entity_count = 1 << 18;
+
+    JobSystem jobs(static_cast<unsigned int>(state.range(0)));
+    Scene scene;
+
+    for (std::size_t i = 0; i < entity_count; i++)
+        scene.create_entity();
+
+    float time = 0.0f;
+
+    for (auto _: state)
+    {
+        state.PauseTiming();
+        time += 0.016f;
+
+        for (std::size_t i = 0; i < entity_count; i++)
+            scene.set_rotation((Entity) i, glm::angleAxis(time, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        state.ResumeTiming();
+
+        scene.update(jobs);
+        benchmark::DoNotOptimize(scene.world(0));
+    }
+
+    state.SetItemsProcessed(state.iterations() * entity_count);
+    state.counters["threads"] = jobs.thread_count();
+}
+
+BENCHMARK(BM_JobScalingTransforms)
+    ->Apply(thread_counts)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// one job per item, measures the scheduling cost itself
+static void BM_JobOverhead(benchmark::State& state)
+{
+    constexpr std::size_t job_count = 4096;
+
+    JobSystem jobs(static_cast<unsigned int>(state.range(0)));
+    std::vector<int> counts(job_count);
+
+    for (auto _: state)
+    {
+        jobs.parallel_for(job_count, 1, [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; i++)
+                counts[i]++;
+        });
+
+        benchmark::DoNotOptimize(counts.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * job_count);
+    state.counters["threads"] = jobs.thread_count();
+}
+
+BENCHMARK(BM_JobOverhead)
+    ->Apply(thread_counts)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
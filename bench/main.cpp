@@ -0,0 +1,19 @@
+#include <cstdlib>
+
+#include <benchmark/benchmark.h>
+
+#include <bench-checks.hpp>
+
+bool bench_check_failed = false;
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return EXIT_FAILURE;
+
+    benchmark::RunSpecifiedBenchmarks();
+
+    return bench_check_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
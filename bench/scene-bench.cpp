@@ -0,0 +1,93 @@
+#include <cmath>
+
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <job-system.hpp>
+#include <scene.hpp>
+
+// every entity is animated each iteration, which is the worst case for the
+// dirty flags. range(0) = entity count, range(1) = children per root
+static void BM_SceneUpdate(benchmark::State& state)
+{
+    auto entity_count = static_cast<std::size_t>(state.range(0));
+    auto children_per_root = static_cast<std::size_t>(state.range(1));
+
+    JobSystem jobs;
+    Scene scene;
+    Bounds unit { glm::vec3(-0.5f), glm::vec3(0.5f) };
+
+    Entity root = no_entity;
+
+    for (std::size_t i = 0; i < entity_count; i++)
+    {
+        if (children_per_root == 0 || i % (children_per_root + 1) == 0)
+            root = scene.create_entity(no_entity, unit);
+        else
+            root = scene.create_entity(root, unit);
+
+        scene.set_position(root, glm::vec3((float) (i % 1000), 0.0f, (float) (i / 1000)));
+    }
+
+    scene.update(jobs);
+
+    float time = 0.0f;
+
+    for (auto _: state)
+    {
+        time += 0.016f;
+
+        for (std::size_t i = 0; i < entity_count; i++)
+        {
+            auto angle = time + (float) i * 0.001f;
+            scene.set_rotation((Entity) i, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+
+        scene.update(jobs);
+        benchmark::DoNotOptimize(scene.world(0));
+    }
+
+    state.SetItemsProcessed(state.iterations() * entity_count);
+    state.counters["threads"] = jobs.thread_count();
+}
+
+BENCHMARK(BM_SceneUpdate)
+    ->ArgsProduct({{1 << 10, 1 << 14, 1 << 17, 1 << 19}, {0, 4}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// only one entity out of every thousand changes, the rest must be skipped
+static void BM_SceneUpdateSparse(benchmark::State& state)
+{
+    auto entity_count = static_cast<std::size_t>(state.range(0));
+
+    JobSystem jobs;
+    Scene scene;
+
+    for (std::size_t i = 0; i < entity_count; i++)
+        scene.create_entity();
+
+    scene.update(jobs);
+
+    float time = 0.0f;
+
+    for (auto _: state)
+    {
+        time += 0.016f;
+
+        for (std::size_t i = 0; i < entity_count; i += 1000)
+            scene.set_position((Entity) i, glm::vec3(time, 0.0f, 0.0f));
+
+        scene.update(jobs);
+        benchmark::DoNotOptimize(scene.world(0));
+    }
+
+    state.SetItemsProcessed(state.iterations() * entity_count);
+}
+
+BENCHMARK(BM_SceneUpdateSparse)
+    ->Arg(1 << 17)
+    ->Arg(1 << 19)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
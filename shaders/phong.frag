@@ -7,31 +7,36 @@ in vec2 TexCoord;
 
 uniform sampler2D main_texture;
 
-uniform vec3 lightPos;
-uniform mat4 lightRot;
-uniform vec3 lightColor;
-uniform vec3 viewPos;
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 lightRot;
+    vec4 lightPos;
+    vec4 lightColor;
+    vec4 viewPos;
+};
 
 void main()
 {
     // ambient
     float ambientStrength = 0.1;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = ambientStrength * lightColor.rgb;
 
     // diffuse
     vec3 norm = normalize(Normal);
 
-    vec3 actualPos = vec3(lightRot * vec4(lightPos, 1.0));
+    vec3 actualPos = vec3(lightRot * lightPos);
     vec3 lightDir = normalize(actualPos - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * lightColor.rgb;
 
     // specular
     float specularStrength = 0.7;
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightColor;
+    vec3 specular = specularStrength * spec * lightColor.rgb;
 
     vec4 objectColor = texture(main_texture, TexCoord);
     FragColor = vec4(ambient + diffuse + specular, 1.0) * objectColor;
@@ -8,9 +8,20 @@ out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 lightRot;
+    vec4 lightPos;
+    vec4 lightColor;
+    vec4 viewPos;
+};
+
+layout (std140) uniform Draw
+{
+    mat4 model;
+};
 
 void main()
 {
@@ -1,9 +1,20 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 lightRot;
+    vec4 lightPos;
+    vec4 lightColor;
+    vec4 viewPos;
+};
+
+layout (std140) uniform Draw
+{
+    mat4 model;
+};
 
 void main()
 {
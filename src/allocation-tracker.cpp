@@ -0,0 +1,293 @@
+#include <allocation-tracker.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+constexpr int tag_count = static_cast<int>(AllocationTag::count);
+
+// relaxed counters, the totals only need to add up once the threads that
+// allocated are synchronized with the reader, like at the end of a frame
+static std::atomic<std::uint64_t> allocations[tag_count];
+static std::atomic<std::uint64_t> bytes[tag_count];
+
+static thread_local AllocationTag current_tag = AllocationTag::other;
+
+static void count(std::size_t size)
+{
+    auto tag = static_cast<int>(current_tag);
+    allocations[tag].fetch_add(1, std::memory_order_relaxed);
+    bytes[tag].fetch_add(size, std::memory_order_relaxed);
+}
+
+static void* allocate(std::size_t size)
+{
+    count(size);
+
+    // malloc(0) may return null, new must not
+    auto pointer = std::malloc(size == 0 ? 1 : size);
+
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+static void* allocate_aligned(std::size_t size, std::align_val_t alignment)
+{
+    count(size);
+
+    auto align = static_cast<std::size_t>(alignment);
+
+#ifdef _WIN32
+    auto pointer = _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+    // aligned_alloc wants a size that is a multiple of the alignment
+    auto pointer = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+static void free_aligned(void* pointer)
+{
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void* operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate_aligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
+
+const char* allocation_tag_name(AllocationTag tag)
+{
+    switch (tag)
+    {
+    case AllocationTag::other: return "other";
+    case AllocationTag::simulation: return "simulation";
+    case AllocationTag::snapshot: return "snapshot";
+    case AllocationTag::draw_list: return "draw list";
+    case AllocationTag::terrain: return "terrain";
+    case AllocationTag::textures: return "textures";
+    case AllocationTag::backend: return "backend";
+    case AllocationTag::reload: return "reload";
+    default: return "unknown";
+    }
+}
+
+AllocationCounts allocation_counts(AllocationTag tag)
+{
+    auto index = static_cast<int>(tag);
+
+    AllocationCounts counts;
+    counts.allocations = allocations[index].load(std::memory_order_relaxed);
+    counts.bytes = bytes[index].load(std::memory_order_relaxed);
+
+    return counts;
+}
+
+AllocationCounts allocation_counts()
+{
+    AllocationCounts total;
+
+    for (int i = 0; i < tag_count; i++)
+    {
+        auto counts = allocation_counts(static_cast<AllocationTag>(i));
+        total.allocations += counts.allocations;
+        total.bytes += counts.bytes;
+    }
+
+    return total;
+}
+
+AllocationTag current_allocation_tag()
+{
+    return current_tag;
+}
+
+AllocationScope::AllocationScope(AllocationTag tag) :
+    _previous(current_tag)
+{
+    current_tag = tag;
+}
+
+AllocationScope::~AllocationScope()
+{
+    current_tag = _previous;
+}
+
+FrameAllocations::FrameAllocations(int warmup_frames, int report_frames) :
+    _warmup_frames(warmup_frames),
+    _report_frames(report_frames)
+{
+    for (int i = 0; i < tag_count; i++)
+        _start[i] = allocation_counts(static_cast<AllocationTag>(i));
+}
+
+void FrameAllocations::begin_frame()
+{
+    for (int i = 0; i < tag_count; i++)
+    {
+        auto counts = allocation_counts(static_cast<AllocationTag>(i));
+
+        _last[i].allocations = counts.allocations - _start[i].allocations;
+        _last[i].bytes = counts.bytes - _start[i].bytes;
+        _start[i] = counts;
+    }
+
+    if (++_frames <= static_cast<std::uint64_t>(_warmup_frames))
+        return;
+
+    auto allocated = false;
+
+    for (int i = 0; i < tag_count; i++)
+    {
+        _window[i].allocations += _last[i].allocations;
+        _window[i].bytes += _last[i].bytes;
+        allocated = allocated || _last[i].allocations > 0;
+    }
+
+    _allocating_frames += allocated;
+
+    if (++_window_frames >= _report_frames)
+        report();
+}
+
+void FrameAllocations::report()
+{
+    if (_allocating_frames > 0)
+    {
+        AllocationCounts total;
+        fmt::memory_buffer subsystems;
+
+        for (int i = 0; i < tag_count; i++)
+        {
+            if (_window[i].allocations == 0)
+                continue;
+
+            total.allocations += _window[i].allocations;
+            total.bytes += _window[i].bytes;
+
+            fmt::format_to(std::back_inserter(subsystems), "{}{} {}",
+                subsystems.size() > 0 ? ", " : "",
+                allocation_tag_name(static_cast<AllocationTag>(i)), _window[i].allocations);
+        }
+
+        spdlog::warn("{} of the last {} frames allocated: {} allocations, {:.1f} KB ({})",
+            _allocating_frames, _window_frames, total.allocations, total.bytes / 1024.0,
+            fmt::to_string(subsystems));
+    }
+
+    for (auto& counts: _window)
+        counts = AllocationCounts();
+
+    _window_frames = 0;
+    _allocating_frames = 0;
+}
+
+AllocationCounts FrameAllocations::last_frame() const
+{
+    AllocationCounts total;
+
+    for (auto& counts: _last)
+    {
+        total.allocations += counts.allocations;
+        total.bytes += counts.bytes;
+    }
+
+    return total;
+}
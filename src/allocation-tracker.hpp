@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+
+// counts the heap allocations of the whole program through the global
+// operator new. every thread charges its allocations to the subsystem of
+// its innermost AllocationScope, and jobs to the one of the thread that
+// submitted them. allocations that bypass operator new, like the ones of
+// the GL driver, are not seen
+
+enum class AllocationTag : std::uint8_t
+{
+    other,
+    simulation,
+    snapshot,
+    draw_list,
+    terrain,
+    textures,
+    backend,
+    reload,
+    count
+};
+
+const char* allocation_tag_name(AllocationTag tag);
+
+struct AllocationCounts
+{
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+};
+
+// totals since the program started, of one subsystem or of all of them
+AllocationCounts allocation_counts(AllocationTag tag);
+AllocationCounts allocation_counts();
+
+AllocationTag current_allocation_tag();
+
+// charges the allocations of the thread to tag while it lives
+class AllocationScope
+{
+public:
+    explicit AllocationScope(AllocationTag tag);
+
+    AllocationScope(const AllocationScope& other) = delete;
+    AllocationScope& operator = (const AllocationScope& other) = delete;
+
+    ~AllocationScope();
+
+private:
+    AllocationTag _previous;
+};
+
+// the allocations of every subsystem between two calls of begin_frame. the
+// frame loop should not allocate once it is warm, so after warmup_frames it
+// warns every report_frames frames about the ones that did
+class FrameAllocations
+{
+public:
+    explicit FrameAllocations(int warmup_frames = 120, int report_frames = 120);
+
+    // closes the last frame and starts counting the next one
+    void begin_frame();
+
+    // of the last closed frame
+    const AllocationCounts& last_frame(AllocationTag tag) const
+    {
+        return _last[static_cast<int>(tag)];
+    }
+
+    AllocationCounts last_frame() const;
+
+private:
+    static constexpr int tag_count = static_cast<int>(AllocationTag::count);
+
+    void report();
+
+    int _warmup_frames;
+    int _report_frames;
+    std::uint64_t _frames = 0;
+
+    AllocationCounts _start[tag_count];
+    AllocationCounts _last[tag_count];
+
+    // since the last report
+    AllocationCounts _window[tag_count];
+    int _window_frames = 0;
+    int _allocating_frames = 0;
+};
@@ -0,0 +1,511 @@
+#include <bvh.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BVH_SSE
+#include <xmmintrin.h>
+#endif
+
+constexpr std::size_t leaf_size = 4;
+constexpr int bin_count = 16;
+
+// below this many levels the build falls back to median splits, which keeps
+// the traversal stack bounded whatever the triangles look like
+constexpr int max_sah_depth = 40;
+constexpr int stack_size = 3 * max_sah_depth + 3 * 32 + 1;
+
+// direction components smaller than this are clamped, so the slab test never
+// multiplies zero by infinity
+constexpr float min_direction = 1e-20f;
+
+constexpr float infinity = std::numeric_limits<float>::infinity();
+
+static Bounds empty_bounds()
+{
+    return Bounds { glm::vec3(infinity), glm::vec3(-infinity) };
+}
+
+static void grow(Bounds& bounds, const Bounds& other)
+{
+    bounds.min = glm::min(bounds.min, other.min);
+    bounds.max = glm::max(bounds.max, other.max);
+}
+
+static float half_area(const Bounds& bounds)
+{
+    auto size = glm::max(bounds.max - bounds.min, glm::vec3(0.0f));
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+MeshBvh::MeshBvh(const float* vertices, std::size_t vertex_count, const Bounds& bounds) :
+    _root(empty_child),
+    _bounds(bounds),
+    _triangle_count(vertex_count / 3)
+{
+    std::vector<BuildTriangle> triangles(_triangle_count);
+
+    for (std::size_t i = 0; i < _triangle_count; i++)
+    {
+        auto& triangle = triangles[i];
+        triangle.bounds = empty_bounds();
+        triangle.index = static_cast<std::uint32_t>(i);
+
+        for (int corner = 0; corner < 3; corner++)
+        {
+            auto position = vertices + (i * 3 + corner) * CsvModel::floats_per_vertex
+                + CsvModel::position_offset;
+            auto point = glm::vec3(position[0], position[1], position[2]);
+
+            triangle.bounds.min = glm::min(triangle.bounds.min, point);
+            triangle.bounds.max = glm::max(triangle.bounds.max, point);
+        }
+
+        triangle.centroid = (triangle.bounds.min + triangle.bounds.max) * 0.5f;
+    }
+
+    if (_triangle_count == 0)
+        return;
+
+    _nodes.reserve(_triangle_count / 2 + 1);
+    _leaves.reserve(_triangle_count / 2 + 1);
+
+    _root = build(triangles, 0, _triangle_count, vertices, 0);
+}
+
+MeshBvh::MeshBvh(const CsvMesh& mesh) :
+    MeshBvh(mesh.vertices.data(), mesh.vertices.size() / CsvModel::floats_per_vertex, mesh.bounds)
+{
+}
+
+MeshBvh::MeshBvh(const CsvModel& model) :
+    MeshBvh(model.vertices(), static_cast<std::size_t>(model.vertex_count()), model.bounds())
+{
+}
+
+std::int32_t MeshBvh::build(std::vector<BuildTriangle>& triangles, std::size_t begin, std::size_t end,
+    const float* vertices, int depth)
+{
+    if (end - begin <= leaf_size)
+    {
+        Leaf leaf = {};
+
+        for (std::size_t lane = 0; lane < leaf_size; lane++)
+        {
+            leaf.triangles[lane] = RayHit::no_triangle;
+
+            if (begin + lane >= end)
+                continue;
+
+            auto index = triangles[begin + lane].index;
+            auto corner = [&](int i) {
+                auto position = vertices + (std::size_t(index) * 3 + i) * CsvModel::floats_per_vertex
+                    + CsvModel::position_offset;
+                return glm::vec3(position[0], position[1], position[2]);
+            };
+
+            auto v0 = corner(0);
+            auto e1 = corner(1) - v0;
+            auto e2 = corner(2) - v0;
+
+            leaf.v0_x[lane] = v0.x, leaf.v0_y[lane] = v0.y, leaf.v0_z[lane] = v0.z;
+            leaf.e1_x[lane] = e1.x, leaf.e1_y[lane] = e1.y, leaf.e1_z[lane] = e1.z;
+            leaf.e2_x[lane] = e2.x, leaf.e2_y[lane] = e2.y, leaf.e2_z[lane] = e2.z;
+            leaf.triangles[lane] = index;
+        }
+
+        _leaves.push_back(leaf);
+        return ~static_cast<std::int32_t>(_leaves.size() - 1);
+    }
+
+    // splits the biggest range in two until there are four children or
+    // every range fits in a leaf
+    std::size_t ranges[4][2] = { { begin, end } };
+    int range_count = 1;
+
+    while (range_count < 4)
+    {
+        auto biggest = 0;
+
+        for (int i = 1; i < range_count; i++)
+            if (ranges[i][1] - ranges[i][0] > ranges[biggest][1] - ranges[biggest][0])
+                biggest = i;
+
+        auto first = ranges[biggest][0];
+        auto last = ranges[biggest][1];
+
+        if (last - first <= leaf_size)
+            break;
+
+        auto middle = split(triangles, first, last, depth >= max_sah_depth);
+
+        ranges[biggest][1] = middle;
+        ranges[range_count][0] = middle;
+        ranges[range_count][1] = last;
+        range_count++;
+    }
+
+    // children are built before the node is filled in, since building them
+    // can reallocate the node array
+    auto node_index = _nodes.size();
+    _nodes.emplace_back();
+
+    Bounds bounds[4];
+    std::int32_t children[4];
+
+    for (int i = 0; i < 4; i++)
+    {
+        bounds[i] = Bounds();
+        children[i] = empty_child;
+
+        if (i >= range_count)
+            continue;
+
+        bounds[i] = empty_bounds();
+
+        for (auto t = ranges[i][0]; t < ranges[i][1]; t++)
+            grow(bounds[i], triangles[t].bounds);
+
+        children[i] = build(triangles, ranges[i][0], ranges[i][1], vertices, depth + 1);
+    }
+
+    auto& node = _nodes[node_index];
+
+    for (int i = 0; i < 4; i++)
+    {
+        node.min_x[i] = bounds[i].min.x, node.min_y[i] = bounds[i].min.y, node.min_z[i] = bounds[i].min.z;
+        node.max_x[i] = bounds[i].max.x, node.max_y[i] = bounds[i].max.y, node.max_z[i] = bounds[i].max.z;
+        node.children[i] = children[i];
+    }
+
+    return static_cast<std::int32_t>(node_index);
+}
+
+// binned surface area heuristic over the centroids, median split on the
+// longest axis when it finds nothing or the tree is already too deep
+std::size_t MeshBvh::split(std::vector<BuildTriangle>& triangles, std::size_t begin, std::size_t end,
+    bool median)
+{
+    auto centroids = empty_bounds();
+
+    for (auto i = begin; i < end; i++)
+    {
+        centroids.min = glm::min(centroids.min, triangles[i].centroid);
+        centroids.max = glm::max(centroids.max, triangles[i].centroid);
+    }
+
+    auto extent = centroids.max - centroids.min;
+    auto longest = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    auto best_axis = -1;
+    auto best_bin = 0;
+    auto best_cost = infinity;
+
+    for (int axis = 0; axis < 3 && !median; axis++)
+    {
+        if (extent[axis] <= 0.0f)
+            continue;
+
+        auto scale = bin_count / extent[axis];
+        std::size_t counts[bin_count] = {};
+        Bounds bins[bin_count];
+        std::fill(std::begin(bins), std::end(bins), empty_bounds());
+
+        for (auto i = begin; i < end; i++)
+        {
+            auto bin = std::min(int((triangles[i].centroid[axis] - centroids.min[axis]) * scale), bin_count - 1);
+            counts[bin]++;
+            grow(bins[bin], triangles[i].bounds);
+        }
+
+        // costs of splitting after each bin, sweeping from the right first
+        float right_costs[bin_count];
+        auto right = empty_bounds();
+        std::size_t right_count = 0;
+
+        for (int bin = bin_count - 1; bin > 0; bin--)
+        {
+            grow(right, bins[bin]);
+            right_count += counts[bin];
+            right_costs[bin - 1] = right_count * half_area(right);
+        }
+
+        auto left = empty_bounds();
+        std::size_t left_count = 0;
+
+        for (int bin = 0; bin < bin_count - 1; bin++)
+        {
+            grow(left, bins[bin]);
+            left_count += counts[bin];
+
+            if (left_count == 0 || left_count == end - begin)
+                continue;
+
+            auto cost = left_count * half_area(left) + right_costs[bin];
+
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = bin;
+            }
+        }
+    }
+
+    if (best_axis >= 0)
+    {
+        auto scale = bin_count / extent[best_axis];
+        auto min = centroids.min[best_axis];
+
+        auto middle = std::partition(triangles.begin() + begin, triangles.begin() + end,
+            [&](const BuildTriangle& triangle) {
+                return std::min(int((triangle.centroid[best_axis] - min) * scale), bin_count - 1) <= best_bin;
+            });
+
+        return static_cast<std::size_t>(middle - triangles.begin());
+    }
+
+    auto middle = begin + (end - begin) / 2;
+
+    std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+        [&](const BuildTriangle& a, const BuildTriangle& b) {
+            return a.centroid[longest] < b.centroid[longest];
+        });
+
+    return middle;
+}
+
+template <bool any_hit>
+bool MeshBvh::traverse(const Ray& ray, RayHit& hit) const
+{
+    if (_root == empty_child)
+        return false;
+
+    glm::vec3 inverse;
+
+    for (int i = 0; i < 3; i++)
+    {
+        auto direction = ray.direction[i];
+
+        if (std::abs(direction) < min_direction)
+            direction = std::copysign(min_direction, direction);
+
+        inverse[i] = 1.0f / direction;
+    }
+
+    auto closest = ray.max_distance;
+    auto found = false;
+
+    std::int32_t stack[stack_size];
+    int stack_top = 0;
+    stack[stack_top++] = _root;
+
+#ifdef BVH_SSE
+    auto origin_x = _mm_set1_ps(ray.origin.x);
+    auto origin_y = _mm_set1_ps(ray.origin.y);
+    auto origin_z = _mm_set1_ps(ray.origin.z);
+    auto inverse_x = _mm_set1_ps(inverse.x);
+    auto inverse_y = _mm_set1_ps(inverse.y);
+    auto inverse_z = _mm_set1_ps(inverse.z);
+    auto direction_x = _mm_set1_ps(ray.direction.x);
+    auto direction_y = _mm_set1_ps(ray.direction.y);
+    auto direction_z = _mm_set1_ps(ray.direction.z);
+    auto zero = _mm_setzero_ps();
+    auto one = _mm_set1_ps(1.0f);
+#endif
+
+    while (stack_top > 0)
+    {
+        auto child = stack[--stack_top];
+
+        if (child < 0)
+        {
+            auto& leaf = _leaves[~child];
+
+            alignas(16) float distances[4];
+            alignas(16) float us[4];
+            alignas(16) float vs[4];
+            int mask = 0;
+
+#ifdef BVH_SSE
+            // Moller-Trumbore on four triangles at once
+            auto e1_x = _mm_load_ps(leaf.e1_x), e1_y = _mm_load_ps(leaf.e1_y), e1_z = _mm_load_ps(leaf.e1_z);
+            auto e2_x = _mm_load_ps(leaf.e2_x), e2_y = _mm_load_ps(leaf.e2_y), e2_z = _mm_load_ps(leaf.e2_z);
+
+            auto p_x = _mm_sub_ps(_mm_mul_ps(direction_y, e2_z), _mm_mul_ps(direction_z, e2_y));
+            auto p_y = _mm_sub_ps(_mm_mul_ps(direction_z, e2_x), _mm_mul_ps(direction_x, e2_z));
+            auto p_z = _mm_sub_ps(_mm_mul_ps(direction_x, e2_y), _mm_mul_ps(direction_y, e2_x));
+
+            auto determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1_x, p_x), _mm_mul_ps(e1_y, p_y)), _mm_mul_ps(e1_z, p_z));
+            auto inverse_determinant = _mm_div_ps(one, determinant);
+
+            auto t_x = _mm_sub_ps(origin_x, _mm_load_ps(leaf.v0_x));
+            auto t_y = _mm_sub_ps(origin_y, _mm_load_ps(leaf.v0_y));
+            auto t_z = _mm_sub_ps(origin_z, _mm_load_ps(leaf.v0_z));
+
+            auto q_x = _mm_sub_ps(_mm_mul_ps(t_y, e1_z), _mm_mul_ps(t_z, e1_y));
+            auto q_y = _mm_sub_ps(_mm_mul_ps(t_z, e1_x), _mm_mul_ps(t_x, e1_z));
+            auto q_z = _mm_sub_ps(_mm_mul_ps(t_x, e1_y), _mm_mul_ps(t_y, e1_x));
+
+            auto u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(t_x, p_x), _mm_mul_ps(t_y, p_y)), _mm_mul_ps(t_z, p_z)), inverse_determinant);
+            auto v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction_x, q_x), _mm_mul_ps(direction_y, q_y)), _mm_mul_ps(direction_z, q_z)), inverse_determinant);
+            auto distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2_x, q_x), _mm_mul_ps(e2_y, q_y)), _mm_mul_ps(e2_z, q_z)), inverse_determinant);
+
+            // unused lanes have a zero determinant and drop out here
+            auto inside = _mm_and_ps(_mm_cmpneq_ps(determinant, zero),
+                _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)),
+                _mm_cmple_ps(_mm_add_ps(u, v), one)));
+
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpgt_ps(distance, zero),
+                _mm_cmplt_ps(distance, _mm_set1_ps(closest))));
+
+            mask = _mm_movemask_ps(inside);
+
+            _mm_store_ps(distances, distance);
+            _mm_store_ps(us, u);
+            _mm_store_ps(vs, v);
+#else
+            for (int lane = 0; lane < 4; lane++)
+            {
+                auto e1 = glm::vec3(leaf.e1_x[lane], leaf.e1_y[lane], leaf.e1_z[lane]);
+                auto e2 = glm::vec3(leaf.e2_x[lane], leaf.e2_y[lane], leaf.e2_z[lane]);
+
+                auto p = glm::cross(ray.direction, e2);
+                auto determinant = glm::dot(e1, p);
+
+                if (determinant == 0.0f)
+                    continue;
+
+                auto inverse_determinant = 1.0f / determinant;
+                auto t = ray.origin - glm::vec3(leaf.v0_x[lane], leaf.v0_y[lane], leaf.v0_z[lane]);
+                auto q = glm::cross(t, e1);
+
+                us[lane] = glm::dot(t, p) * inverse_determinant;
+                vs[lane] = glm::dot(ray.direction, q) * inverse_determinant;
+                distances[lane] = glm::dot(e2, q) * inverse_determinant;
+
+                if (us[lane] >= 0.0f && vs[lane] >= 0.0f && us[lane] + vs[lane] <= 1.0f
+                    && distances[lane] > 0.0f && distances[lane] < closest)
+                    mask |= 1 << lane;
+            }
+#endif
+
+            if (mask == 0)
+                continue;
+
+            if (any_hit)
+                return true;
+
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if ((mask & (1 << lane)) == 0 || distances[lane] >= closest)
+                    continue;
+
+                closest = distances[lane];
+                hit.distance = distances[lane];
+                hit.triangle = leaf.triangles[lane];
+                hit.u = us[lane];
+                hit.v = vs[lane];
+                found = true;
+            }
+
+            continue;
+        }
+
+        auto& node = _nodes[child];
+
+        alignas(16) float nears[4];
+        int mask = 0;
+
+#ifdef BVH_SSE
+        auto t0_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.min_x), origin_x), inverse_x);
+        auto t1_x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.max_x), origin_x), inverse_x);
+        auto t0_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.min_y), origin_y), inverse_y);
+        auto t1_y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.max_y), origin_y), inverse_y);
+        auto t0_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.min_z), origin_z), inverse_z);
+        auto t1_z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.max_z), origin_z), inverse_z);
+
+        auto near = _mm_max_ps(
+            _mm_max_ps(_mm_min_ps(t0_x, t1_x), _mm_min_ps(t0_y, t1_y)),
+            _mm_max_ps(_mm_min_ps(t0_z, t1_z), zero));
+
+        auto far = _mm_min_ps(
+            _mm_min_ps(_mm_max_ps(t0_x, t1_x), _mm_max_ps(t0_y, t1_y)),
+            _mm_min_ps(_mm_max_ps(t0_z, t1_z), _mm_set1_ps(closest)));
+
+        mask = _mm_movemask_ps(_mm_cmple_ps(near, far));
+        _mm_store_ps(nears, near);
+#else
+        for (int lane = 0; lane < 4; lane++)
+        {
+            auto t0 = (glm::vec3(node.min_x[lane], node.min_y[lane], node.min_z[lane]) - ray.origin) * inverse;
+            auto t1 = (glm::vec3(node.max_x[lane], node.max_y[lane], node.max_z[lane]) - ray.origin) * inverse;
+            auto low = glm::min(t0, t1);
+            auto high = glm::max(t0, t1);
+
+            nears[lane] = std::max(std::max(low.x, low.y), std::max(low.z, 0.0f));
+            auto far = std::min(std::min(high.x, high.y), std::min(high.z, closest));
+
+            if (nears[lane] <= far)
+                mask |= 1 << lane;
+        }
+#endif
+
+        // pushes the hit children far to near, so the nearest is visited
+        // first and shrinks closest for the others
+        int order[4];
+        int count = 0;
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if ((mask & (1 << lane)) == 0 || node.children[lane] == empty_child)
+                continue;
+
+            auto i = count++;
+
+            for (; i > 0 && nears[order[i - 1]] < nears[lane]; i--)
+                order[i] = order[i - 1];
+
+            order[i] = lane;
+        }
+
+        for (int i = 0; i < count; i++)
+            stack[stack_top++] = node.children[order[i]];
+    }
+
+    return found;
+}
+
+bool MeshBvh::intersect(const Ray& ray, RayHit& hit) const
+{
+    hit = RayHit();
+    return traverse<false>(ray, hit);
+}
+
+bool MeshBvh::occluded(const Ray& ray) const
+{
+    RayHit hit;
+    return traverse<true>(ray, hit);
+}
+
+void MeshBvh::intersect(const Ray* rays, RayHit* hits, std::size_t count) const
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        hits[i] = RayHit();
+        traverse<false>(rays[i], hits[i]);
+    }
+}
+
+void MeshBvh::occluded(const Ray* rays, std::uint8_t* occluded, std::size_t count) const
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        RayHit hit;
+        occluded[i] = traverse<true>(rays[i], hit) ? 1 : 0;
+    }
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <csv-model.hpp>
+#include <transform.hpp>
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+
+    // in units of direction, hits further than this are ignored
+    float max_distance = std::numeric_limits<float>::infinity();
+};
+
+struct RayHit
+{
+    static constexpr std::uint32_t no_triangle = ~std::uint32_t(0);
+
+    float distance = std::numeric_limits<float>::infinity();
+    std::uint32_t triangle = no_triangle;
+
+    // barycentric coordinates of the hit inside the triangle
+    float u = 0.0f;
+    float v = 0.0f;
+
+    bool hit() const
+    {
+        return triangle != no_triangle;
+    }
+};
+
+// bounding volume hierarchy over the triangles of one mesh. every node has
+// four children and every leaf four triangles, so one ray is tested against
+// four boxes or four triangles at a time with SSE
+class MeshBvh
+{
+public:
+    // vertices in the CsvModel layout, three per triangle
+    MeshBvh(const float* vertices, std::size_t vertex_count, const Bounds& bounds);
+
+    explicit MeshBvh(const CsvMesh& mesh);
+    explicit MeshBvh(const CsvModel& model);
+
+    // closest hit along the ray, false when there is none
+    bool intersect(const Ray& ray, RayHit& hit) const;
+
+    // any hit along the ray, which can stop at the first triangle found
+    bool occluded(const Ray& ray) const;
+
+    // the same for a batch of rays, hits[i] and occluded[i] belong to rays[i]
+    void intersect(const Ray* rays, RayHit* hits, std::size_t count) const;
+    void occluded(const Ray* rays, std::uint8_t* occluded, std::size_t count) const;
+
+    const Bounds& bounds() const
+    {
+        return _bounds;
+    }
+
+    std::size_t triangle_count() const
+    {
+        return _triangle_count;
+    }
+
+    std::size_t node_count() const
+    {
+        return _nodes.size();
+    }
+
+private:
+    // children[i] >= 0 is a node, < 0 is the leaf ~children[i], and
+    // empty_child marks unused slots
+    static constexpr std::int32_t empty_child = std::numeric_limits<std::int32_t>::min();
+
+    struct alignas(16) Node
+    {
+        float min_x[4];
+        float min_y[4];
+        float min_z[4];
+        float max_x[4];
+        float max_y[4];
+        float max_z[4];
+        std::int32_t children[4];
+    };
+
+    // four triangles as a corner and two edges, ready for Moller-Trumbore.
+    // unused lanes have zero edges and never hit
+    struct alignas(16) Leaf
+    {
+        float v0_x[4];
+        float v0_y[4];
+        float v0_z[4];
+        float e1_x[4];
+        float e1_y[4];
+        float e1_z[4];
+        float e2_x[4];
+        float e2_y[4];
+        float e2_z[4];
+        std::uint32_t triangles[4];
+    };
+
+    struct BuildTriangle
+    {
+        Bounds bounds;
+        glm::vec3 centroid;
+        std::uint32_t index;
+    };
+
+    std::int32_t build(std::vector<BuildTriangle>& triangles, std::size_t begin, std::size_t end,
+        const float* vertices, int depth);
+    std::size_t split(std::vector<BuildTriangle>& triangles, std::size_t begin, std::size_t end,
+        bool median);
+
+    template <bool any_hit>
+    bool traverse(const Ray& ray, RayHit& hit) const;
+
+    std::vector<Node> _nodes;
+    std::vector<Leaf> _leaves;
+    std::int32_t _root;
+
+    Bounds _bounds;
+    std::size_t _triangle_count;
+};
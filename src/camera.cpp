@@ -37,24 +37,24 @@ void Camera::turn(float x, float y)
     _front = glm::normalize(direction);
 }
 
-void Camera::move_front()
+void Camera::move_front(float dt)
 {
-    _pos += _speed * _front;
+    _pos += _speed * dt * _front;
 }
 
-void Camera::move_back()
+void Camera::move_back(float dt)
 {
-    _pos -= _speed * _front;
+    _pos -= _speed * dt * _front;
 }
 
-void Camera::move_left()
+void Camera::move_left(float dt)
 {
-    _pos -= glm::normalize(glm::cross(_front, _up)) * _speed;
+    _pos -= glm::normalize(glm::cross(_front, _up)) * _speed * dt;
 }
 
-void Camera::move_right()
+void Camera::move_right(float dt)
 {
-    _pos += glm::normalize(glm::cross(_front, _up)) * _speed;
+    _pos += glm::normalize(glm::cross(_front, _up)) * _speed * dt;
 }
 
 glm::mat4 Camera::look_at()
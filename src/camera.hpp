@@ -9,22 +9,33 @@ public:
         glm::vec3 pos, glm::vec3 front,
         glm::vec3 up, float sensitivity = 1.0f,
         float yaw = -90.0f, float pitch = 0.0f,
-        float speed = 0.05f);
+        float speed = 3.0f);
 
     void turn(float x, float y);
 
-    void move_front();
-    void move_back();
-    void move_left();
-    void move_right();
+    // speed is in units per second, dt in seconds
+    void move_front(float dt);
+    void move_back(float dt);
+    void move_left(float dt);
+    void move_right(float dt);
 
     glm::mat4 look_at();
 
-    glm::vec3 pos()
+    glm::vec3 pos() const
     {
         return _pos;
     }
 
+    glm::vec3 front() const
+    {
+        return _front;
+    }
+
+    glm::vec3 up() const
+    {
+        return _up;
+    }
+
 private:
     glm::vec3 _pos;
     glm::vec3 _front;
@@ -0,0 +1,199 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <cooked-assets.hpp>
+#include <csv-model.hpp>
+#include <job-system.hpp>
+#include <mesh-tools.hpp>
+#include <settings.hpp>
+#include <texture.hpp>
+
+// turns the csv meshes and images in res/ that settings.json uses into the
+// binary files the game loads, so it never parses, decodes or generates
+// normals at startup
+
+struct CookOptions
+{
+    NormalMode normals = NormalMode::keep;
+    bool force = false;
+};
+
+static void print_usage()
+{
+    spdlog::info("usage: cook <settings.json> [--normals keep|flat|smooth] [--force]");
+}
+
+// the output is newer than the source, so cooking again would change nothing
+static bool up_to_date(const std::string& source, const std::string& output)
+{
+    std::error_code error;
+    auto output_time = std::filesystem::last_write_time(output, error);
+
+    if (error)
+        return false;
+
+    return output_time >= std::filesystem::last_write_time(source);
+}
+
+static bool cook_mesh(JobSystem& jobs, const Settings& settings, const std::string& model, const CookOptions& options)
+{
+    auto source = fmt::format("{}/res/{}", settings.root_folder, model);
+    auto output = cooked_mesh_path(settings, model);
+
+    // meshes cooked by older versions or with other normals are cooked again
+    if (!options.force && up_to_date(source, output)
+        && cooked_version(output) == cooked_mesh_version
+        && cooked_mesh_normals(output) == options.normals)
+    {
+        return false;
+    }
+
+    auto mesh = CsvModel::parse_csv(source);
+    auto report = validate_mesh(mesh);
+
+    if (report.invalid_values > 0)
+    {
+        spdlog::error("{}: {} values are NaN or infinite", model, report.invalid_values);
+        throw std::invalid_argument("mesh with invalid values");
+    }
+
+    if (report.degenerate_triangles > 0)
+    {
+        spdlog::warn("{}: removing {} of {} triangles without area",
+            model, report.degenerate_triangles, report.triangles);
+
+        remove_degenerate_triangles(mesh);
+    }
+
+    if (mesh.vertices.size() % (3 * CsvModel::floats_per_vertex) != 0)
+        spdlog::warn("{}: vertex count is not a multiple of 3", model);
+
+    generate_normals(jobs, mesh, options.normals);
+    CsvModel::compute_bounds(mesh);
+
+    write_cooked_mesh(output, mesh, options.normals);
+    spdlog::info("{}: {} triangles", model, mesh.vertices.size() / (3 * CsvModel::floats_per_vertex));
+
+    return true;
+}
+
+static bool cook_image(const Settings& settings, const std::string& texture, const CookOptions& options)
+{
+    auto source = fmt::format("{}/res/{}", settings.root_folder, texture);
+    auto output = cooked_image_path(settings, texture);
+
+    // images cooked by older versions have no mip chain
+    if (!options.force && up_to_date(source, output) && cooked_version(output) == cooked_image_version)
+        return false;
+
+    auto image = load_image(source);
+    write_cooked_image(output, image);
+    spdlog::info("{}: {}x{}, {} channels, {} mip levels", texture,
+        image.width, image.height, image.channels, mip_levels(image.width, image.height));
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    CookOptions options;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--force") == 0)
+        {
+            options.force = true;
+        }
+        else if (std::strcmp(argv[i], "--normals") == 0 && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+
+            if (mode == "keep")
+                options.normals = NormalMode::keep;
+            else if (mode == "flat")
+                options.normals = NormalMode::flat;
+            else if (mode == "smooth")
+                options.normals = NormalMode::smooth;
+            else
+            {
+                print_usage();
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            print_usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto settings = load_settings(argv[1]);
+
+    std::set<std::string> models;
+    std::set<std::string> textures;
+
+    for (auto& object: settings.objects)
+    {
+        models.insert(object.model);
+        textures.insert(object.texture);
+    }
+
+    models.insert(settings.sun.model);
+
+    if (settings.terrain.enabled)
+    {
+        textures.insert(settings.terrain.texture);
+
+        if (!settings.terrain.heightmap.empty())
+            textures.insert(settings.terrain.heightmap);
+    }
+
+    std::filesystem::create_directories(
+        fmt::format("{}/{}", settings.root_folder, settings.cooked_folder));
+
+    std::vector<std::string> assets(models.begin(), models.end());
+    assets.insert(assets.end(), textures.begin(), textures.end());
+
+    JobSystem jobs;
+    std::atomic<int> cooked { 0 };
+    std::atomic<int> failed { 0 };
+
+    // one asset per job, the normal generation splits big meshes further
+    jobs.parallel_for(assets.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++)
+        {
+            try
+            {
+                auto changed = i < models.size()
+                    ? cook_mesh(jobs, settings, assets[i], options)
+                    : cook_image(settings, assets[i], options);
+
+                cooked += changed;
+            }
+            catch (const std::exception& e)
+            {
+                spdlog::error("failed to cook {}: {}", assets[i], e.what());
+                failed++;
+            }
+        }
+    });
+
+    spdlog::info("cooked {} of {} assets, {} failed",
+        cooked.load(), assets.size(), failed.load());
+
+    return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,408 @@
+#include <cooked-assets.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+struct CookedMeshHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t vertex_count;
+    std::uint32_t floats_per_vertex;
+    std::uint32_t normals; // the NormalMode they were generated with
+    float bounds_min[3];
+    float bounds_max[3];
+};
+
+struct CookedImageHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t channels;
+    std::uint32_t levels;
+};
+
+// one per level after the image header, the offsets are from the start of
+// the file
+struct CookedMipEntry
+{
+    std::uint64_t offset;
+    std::uint32_t width;
+    std::uint32_t height;
+};
+
+constexpr char mesh_magic[4] = { 'O', 'G', 'T', 'M' };
+constexpr char image_magic[4] = { 'O', 'G', 'T', 'I' };
+
+template <typename Write>
+static void write_atomically(const std::string& filename, Write&& write)
+{
+    auto temporary = filename + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+
+        if (!file.is_open())
+        {
+            spdlog::error("could not write \"{}\"", temporary);
+            throw std::invalid_argument("could not write cooked asset");
+        }
+
+        write(file);
+
+        if (!file)
+        {
+            spdlog::error("could not write \"{}\"", temporary);
+            throw std::invalid_argument("could not write cooked asset");
+        }
+    }
+
+    std::filesystem::rename(temporary, filename);
+}
+
+void write_cooked_mesh(const std::string& filename, const CsvMesh& mesh, NormalMode normals)
+{
+    CookedMeshHeader header;
+    std::memcpy(header.magic, mesh_magic, sizeof(mesh_magic));
+    header.version = cooked_mesh_version;
+    header.vertex_count = static_cast<std::uint32_t>(mesh.vertices.size() / CsvModel::floats_per_vertex);
+    header.floats_per_vertex = CsvModel::floats_per_vertex;
+    header.normals = static_cast<std::uint32_t>(normals);
+
+    for (int i = 0; i < 3; i++)
+    {
+        header.bounds_min[i] = mesh.bounds.min[i];
+        header.bounds_max[i] = mesh.bounds.max[i];
+    }
+
+    write_atomically(filename, [&](std::ofstream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+            header.vertex_count * CsvModel::floats_per_vertex * sizeof(float));
+    });
+}
+
+void write_cooked_image(const std::string& filename, const Image& image)
+{
+    auto levels = mip_levels(image.width, image.height);
+
+    std::vector<Image> mips;
+    mips.reserve(levels - 1);
+
+    for (int i = 1; i < levels; i++)
+        mips.push_back(downsample(i == 1 ? image : mips.back()));
+
+    auto level = [&](int i) -> const Image& {
+        return i == 0 ? image : mips[i - 1];
+    };
+
+    CookedImageHeader header;
+    std::memcpy(header.magic, image_magic, sizeof(image_magic));
+    header.version = cooked_image_version;
+    header.width = static_cast<std::uint32_t>(image.width);
+    header.height = static_cast<std::uint32_t>(image.height);
+    header.channels = static_cast<std::uint32_t>(image.channels);
+    header.levels = static_cast<std::uint32_t>(levels);
+
+    std::vector<CookedMipEntry> entries(levels);
+    std::uint64_t offset = sizeof(header) + levels * sizeof(CookedMipEntry);
+
+    for (int i = 0; i < levels; i++)
+    {
+        entries[i].offset = offset;
+        entries[i].width = static_cast<std::uint32_t>(level(i).width);
+        entries[i].height = static_cast<std::uint32_t>(level(i).height);
+        offset += std::uint64_t(entries[i].width) * entries[i].height * image.channels;
+    }
+
+    write_atomically(filename, [&](std::ofstream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), levels * sizeof(CookedMipEntry));
+
+        for (int i = 0; i < levels; i++)
+        {
+            file.write(reinterpret_cast<const char*>(level(i).pixels.get()),
+                std::size_t(entries[i].width) * entries[i].height * image.channels);
+        }
+    });
+}
+
+template <typename Header>
+static Header read_header(std::ifstream& file, const std::string& filename,
+    const char (&magic)[4], unsigned int version)
+{
+    Header header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file || std::memcmp(header.magic, magic, 4) != 0 || header.version != version)
+    {
+        spdlog::error("\"{}\" is not a cooked asset of version {}, cook it again", filename, version);
+        throw std::invalid_argument("invalid cooked asset");
+    }
+
+    return header;
+}
+
+static std::ifstream open_cooked(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file.is_open())
+    {
+        spdlog::error("could not open cooked asset \"{}\"", filename);
+        throw std::invalid_argument("could not open cooked asset");
+    }
+
+    return file;
+}
+
+CsvMesh read_cooked_mesh(const std::string& filename)
+{
+    auto file = open_cooked(filename);
+    auto header = read_header<CookedMeshHeader>(file, filename, mesh_magic, cooked_mesh_version);
+
+    if (header.floats_per_vertex != CsvModel::floats_per_vertex)
+    {
+        spdlog::error("\"{}\" has {} floats per vertex", filename, header.floats_per_vertex);
+        throw std::invalid_argument("invalid cooked asset");
+    }
+
+    CsvMesh mesh;
+    mesh.vertices.resize(std::size_t(header.vertex_count) * CsvModel::floats_per_vertex);
+    mesh.bounds.min = glm::vec3(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]);
+    mesh.bounds.max = glm::vec3(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]);
+
+    file.read(reinterpret_cast<char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(float));
+
+    if (!file)
+    {
+        spdlog::error("cooked asset \"{}\" is truncated", filename);
+        throw std::invalid_argument("invalid cooked asset");
+    }
+
+    return mesh;
+}
+
+NormalMode cooked_mesh_normals(const std::string& filename)
+{
+    auto file = open_cooked(filename);
+    auto header = read_header<CookedMeshHeader>(file, filename, mesh_magic, cooked_mesh_version);
+
+    return static_cast<NormalMode>(header.normals);
+}
+
+static CookedImageInfo read_image_info(std::ifstream& file, const std::string& filename)
+{
+    auto header = read_header<CookedImageHeader>(file, filename, image_magic, cooked_image_version);
+
+    if (header.levels != static_cast<std::uint32_t>(mip_levels(header.width, header.height)))
+    {
+        spdlog::error("\"{}\" has {} mip levels", filename, header.levels);
+        throw std::invalid_argument("invalid cooked asset");
+    }
+
+    std::vector<CookedMipEntry> entries(header.levels);
+    file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(CookedMipEntry));
+
+    if (!file)
+    {
+        spdlog::error("cooked asset \"{}\" is truncated", filename);
+        throw std::invalid_argument("invalid cooked asset");
+    }
+
+    CookedImageInfo info;
+    info.channels = static_cast<int>(header.channels);
+
+    for (auto& entry: entries)
+    {
+        info.mips.push_back(CookedMip {
+            entry.offset, static_cast<int>(entry.width), static_cast<int>(entry.height) });
+    }
+
+    return info;
+}
+
+CookedImageInfo read_cooked_image_info(const std::string& filename)
+{
+    auto file = open_cooked(filename);
+    return read_image_info(file, filename);
+}
+
+std::vector<Image> read_cooked_mips(const std::string& filename, int first, int count)
+{
+    auto file = open_cooked(filename);
+    auto info = read_image_info(file, filename);
+
+    if (first < 0 || count < 0 || first + count > static_cast<int>(info.mips.size()))
+    {
+        spdlog::error("\"{}\" has no mip levels {} to {}", filename, first, first + count - 1);
+        throw std::invalid_argument("invalid mip level");
+    }
+
+    std::vector<Image> images;
+
+    for (int i = first; i < first + count; i++)
+    {
+        auto& mip = info.mips[i];
+        auto size = std::size_t(mip.width) * mip.height * info.channels;
+
+        Image image;
+        image.width = mip.width;
+        image.height = mip.height;
+        image.channels = info.channels;
+        image.pixels = { static_cast<unsigned char*>(std::malloc(size)), std::free };
+
+        file.seekg(static_cast<std::streamoff>(mip.offset));
+        file.read(reinterpret_cast<char*>(image.pixels.get()), size);
+
+        if (!file)
+        {
+            spdlog::error("cooked asset \"{}\" is truncated", filename);
+            throw std::invalid_argument("invalid cooked asset");
+        }
+
+        images.push_back(std::move(image));
+    }
+
+    return images;
+}
+
+Image read_cooked_image(const std::string& filename)
+{
+    return std::move(read_cooked_mips(filename, 0, 1).front());
+}
+
+unsigned int cooked_version(const std::string& filename)
+{
+    struct
+    {
+        char magic[4];
+        std::uint32_t version;
+    } header;
+
+    std::ifstream file(filename, std::ios::binary);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file)
+        return 0;
+
+    if (std::memcmp(header.magic, mesh_magic, 4) != 0 && std::memcmp(header.magic, image_magic, 4) != 0)
+        return 0;
+
+    return header.version;
+}
+
+std::string cooked_mesh_path(const Settings& settings, const std::string& model)
+{
+    return fmt::format("{}/{}/{}.mesh", settings.root_folder, settings.cooked_folder, model);
+}
+
+std::string cooked_image_path(const Settings& settings, const std::string& texture)
+{
+    return fmt::format("{}/{}/{}.image", settings.root_folder, settings.cooked_folder, texture);
+}
+
+// whether the cooked file of name can be loaded instead of its source,
+// warns about why not
+static bool cooked_is_current(const std::string& name, const std::string& cooked,
+    const std::string& source, unsigned int version, const char* fallback)
+{
+    if (!std::filesystem::exists(cooked))
+    {
+        spdlog::warn("\"{}\" is not cooked, {}", name, fallback);
+        return false;
+    }
+
+    if (cooked_version(cooked) != version)
+    {
+        spdlog::warn("\"{}\" was cooked by another version of the cook tool, {}", name, fallback);
+        return false;
+    }
+
+    // without the source there is nothing newer to load
+    std::error_code error;
+    auto source_time = std::filesystem::last_write_time(source, error);
+
+    if (!error && source_time > std::filesystem::last_write_time(cooked))
+    {
+        spdlog::warn("\"{}\" changed since it was cooked, {}", name, fallback);
+        return false;
+    }
+
+    return true;
+}
+
+CsvMesh load_mesh_asset(JobSystem& jobs, const Settings& settings, const std::string& model)
+{
+    auto cooked = cooked_mesh_path(settings, model);
+    auto source = fmt::format("{}/res/{}", settings.root_folder, model);
+
+    if (cooked_is_current(model, cooked, source, cooked_mesh_version, "loading the csv"))
+        return read_cooked_mesh(cooked);
+
+    // zero normals would light the mesh with NaN
+    auto mesh = CsvModel::parse_csv(source);
+    generate_normals(jobs, mesh, NormalMode::keep);
+
+    return mesh;
+}
+
+Image load_image_asset(const Settings& settings, const std::string& texture)
+{
+    auto cooked = cooked_image_path(settings, texture);
+    auto source = fmt::format("{}/res/{}", settings.root_folder, texture);
+
+    if (cooked_is_current(texture, cooked, source, cooked_image_version, "decoding the image"))
+        return read_cooked_image(cooked);
+
+    return load_image(source);
+}
+
+std::shared_ptr<Texture> load_texture_asset(const Settings& settings, const std::string& texture)
+{
+    if (!settings.texture_streaming.enabled)
+        return std::make_shared<Texture>(load_image_asset(settings, texture));
+
+    auto cooked = cooked_image_path(settings, texture);
+    auto source = fmt::format("{}/res/{}", settings.root_folder, texture);
+
+    // only cooked files have the levels to stream
+    if (!cooked_is_current(texture, cooked, source, cooked_image_version, "decoding the image"))
+        return std::make_shared<Texture>(load_image(source));
+
+    auto info = read_cooked_image_info(cooked);
+    auto levels = static_cast<int>(info.mips.size());
+
+    // the finest level that fits the tail, which stays in memory for good
+    auto tail = 0;
+
+    while (tail + 1 < levels &&
+        std::max(info.mips[tail].width, info.mips[tail].height) > settings.texture_streaming.tail_size)
+    {
+        tail++;
+    }
+
+    auto image = std::move(read_cooked_mips(cooked, tail, 1).front());
+
+    if (tail == 0)
+        return std::make_shared<Texture>(std::move(image));
+
+    MipSource mip_source;
+    mip_source.filename = cooked;
+    mip_source.level = tail;
+    mip_source.levels = levels;
+    mip_source.width = info.mips[0].width;
+    mip_source.height = info.mips[0].height;
+
+    return std::make_shared<Texture>(std::move(image), std::move(mip_source));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <csv-model.hpp>
+#include <mesh-tools.hpp>
+#include <settings.hpp>
+#include <texture.hpp>
+
+// binary files written by the cook tool, laid out so the game can read them
+// straight into memory without parsing or decoding anything
+
+constexpr unsigned int cooked_mesh_version = 2;
+constexpr unsigned int cooked_image_version = 2;
+
+// cooked images hold their whole mip chain, each level stored on its own so
+// any of them can be read without the others
+struct CookedMip
+{
+    std::uint64_t offset;
+    int width;
+    int height;
+};
+
+struct CookedImageInfo
+{
+    int channels = 0;
+    std::vector<CookedMip> mips;
+};
+
+// both write to a temporary file first, so a reader never sees half a file.
+// meshes remember how their normals were generated, images are written with
+// every level of their mip chain
+void write_cooked_mesh(const std::string& filename, const CsvMesh& mesh, NormalMode normals);
+void write_cooked_image(const std::string& filename, const Image& image);
+
+CsvMesh read_cooked_mesh(const std::string& filename);
+
+NormalMode cooked_mesh_normals(const std::string& filename);
+
+// level 0 of the image
+Image read_cooked_image(const std::string& filename);
+
+CookedImageInfo read_cooked_image_info(const std::string& filename);
+
+// count levels starting at first, finest first
+std::vector<Image> read_cooked_mips(const std::string& filename, int first, int count);
+
+// the version of a cooked file, 0 when it is not one
+unsigned int cooked_version(const std::string& filename);
+
+// where the cook tool puts the cooked version of a file in res/
+std::string cooked_mesh_path(const Settings& settings, const std::string& model);
+std::string cooked_image_path(const Settings& settings, const std::string& texture);
+
+// the cooked asset when there is one of this version, otherwise the source
+// file in res/ with a warning, since that means the cook tool was not run.
+// a source newer than its cooked file is loaded too, so edits to res/ show
+// up before cooking again
+// csv files without normals get flat ones, like the cook tool gives them
+CsvMesh load_mesh_asset(JobSystem& jobs, const Settings& settings, const std::string& model);
+Image load_image_asset(const Settings& settings, const std::string& texture);
+
+// a texture of the objects. with texture streaming enabled only the levels
+// up to tail-size are read and the texture streams the finer ones
+std::shared_ptr<Texture> load_texture_asset(const Settings& settings, const std::string& texture);
@@ -1,64 +1,37 @@
 #include <csv-model.hpp>
 
-#include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include <utility>
 
 #include <glm/glm.hpp>
-#include <glm/gtc/type_ptr.hpp>
 #include <spdlog/spdlog.h>
 
 CsvModel::CsvModel(
     const std::string& filename,
-    std::shared_ptr<ShaderProgram> shader,
     std::shared_ptr<Texture> texture)
+    : CsvModel(parse_csv(filename), std::move(texture))
 {
-    _vertex_count = 0;
-    _vertices = nullptr;
-    _vao = 0;
-    _vbo = 0;
-
-    _shader = std::move(shader);
-    _texture = std::move(texture);
-
-    parse_csv(filename);
-    init_buffers();
 }
 
-CsvModel::CsvModel(CsvModel&& other)
+CsvModel::CsvModel(
+    CsvMesh mesh,
+    std::shared_ptr<Texture> texture)
 {
-    _vertex_count = other._vertex_count;
-    _vertices = other._vertices;
-    _vao = other._vao;
-    _vbo = other._vbo;
-
-    _shader = std::move(other._shader);
-    _texture = std::move(other._texture);
-
-    other._vertex_count = 0;
-    other._vertices = nullptr;
-    other._vao = 0;
-    other._vbo = 0;
+    _mesh = std::move(mesh);
+    _vertex_count = static_cast<int>(_mesh.vertices.size()) / floats_per_vertex;
+
+    _texture = std::move(texture);
 }
 
-CsvModel& CsvModel::operator = (CsvModel&& other)
+void CsvModel::swap_mesh(CsvMesh& mesh)
 {
-    _vertex_count = other._vertex_count;
-    _vertices = other._vertices;
-    _vao = other._vao;
-    _vbo = other._vbo;
-
-    _shader = std::move(other._shader);
-    _texture = std::move(other._texture);
-
-    other._vertex_count = 0;
-    other._vertices = nullptr;
-    other._vao = 0;
-    other._vbo = 0;
-
-    return *this;
+    std::swap(_mesh, mesh);
+    _vertex_count = static_cast<int>(_mesh.vertices.size()) / floats_per_vertex;
+    _version++;
 }
 
-void CsvModel::parse_csv(const std::string& filename)
+CsvMesh CsvModel::parse_csv(const std::string& filename)
 {
     std::ifstream source_file(filename);
 
@@ -69,183 +42,93 @@ void CsvModel::parse_csv(const std::string& filename)
     }
 
     std::string line;
+    int vertex_count = 0;
 
     while (std::getline(source_file, line))
-#ifdef GENERATE_NORMALS
-        _vertex_count += true_floats_per_line;
-#else
-        _vertex_count += floats_per_line;
-#endif // GENERATE_NORMALS
+    {
+        if (!line.empty())
+            vertex_count++;
+    }
 
-    _vertices = new float[_vertex_count];
+    CsvMesh mesh;
+    mesh.vertices.resize(vertex_count * floats_per_vertex);
+    auto vertices = mesh.vertices.data();
 
-    spdlog::info("vertex count {}", _vertex_count);
+    spdlog::info("vertex count {}", vertex_count);
 
     source_file.clear();
     source_file.seekg(0);
 
     int it = 0;
+    int line_number = 0;
 
     while (std::getline(source_file, line))
     {
+        line_number++;
+
+        if (line.empty())
+            continue;
+
         int start_of_line = it;
         std::string::size_type begin = 0;
 
-        while (true)
+        while (it - start_of_line < floats_per_vertex)
         {
             auto end = line.find(';', begin);
 
-            if (end == std::string::npos || it == _vertex_count)
+            if (end == std::string::npos)
                 break;
 
             auto substr = line.substr(begin, end - begin);
-            _vertices[it] = std::stof(substr);
+            vertices[it] = std::stof(substr);
 
             it++;
             begin = end + 1;
         }
 
-#ifdef GENERATE_NORMALS
-        it += true_floats_per_line - file_floats_per_line;
-#endif // GENERATE_NORMALS
-    }
-
-#ifdef GENERATE_NORMALS
-    it = 0;
+        auto values = it - start_of_line;
 
-    while (it < _vertex_count)
-    {
-        glm::vec3 vertices[3];
-
-        for (int i = 0; i < 3; i++)
+        // older files leave the normals out, they are zeroed here and made
+        // by the cook tool or by load_mesh_asset
+        if (values == floats_without_normals)
         {
-            int offset = it + i * true_floats_per_line;
-            vertices[i].x = _vertices[offset];
-            vertices[i].y = _vertices[offset + 1];
-            vertices[i].z = _vertices[offset + 2];
-            spdlog::info("vertex {}, {}, {}", vertices[i].x, vertices[i].y, vertices[i].z);
-        }
-
-        auto normal = glm::cross(
-            vertices[0] - vertices[1],
-            vertices[1] - vertices[2]
-        );
-
-        spdlog::info("normal {}, {}, {}", normal.x, normal.y, normal.z);
+            mesh.has_normals = false;
 
-        for (int i = 0; i < 3; i++)
+            for (; it < start_of_line + floats_per_vertex; it++)
+                vertices[it] = 0.0f;
+        }
+        else if (values != floats_per_vertex)
         {
-            int offset = it + i * true_floats_per_line + file_floats_per_line;
-            _vertices[offset] = normal.x;
-            _vertices[offset + 1] = normal.y;
-            _vertices[offset + 2] = normal.z;
+            spdlog::error("\"{}\" line {} has {} values", filename, line_number, values);
+            throw std::invalid_argument("malformed csv model");
         }
-
-        it += 3 * true_floats_per_line;
     }
 
-    // it = 0;
-
-    // while (it < _vertex_count)
-    // {
-    //     spdlog::info("vert: {}", _vertices[it]);
-    //     it++;
-    //     if (it % true_floats_per_line == 0)
-    //         spdlog::info("--------------");
-    // }
-#endif // GENERATE_NORMALS
-}
+    compute_bounds(mesh);
 
-void CsvModel::init_buffers()
-{
-    glGenVertexArrays(1, &_vao);
-    glGenBuffers(1, &_vbo);
-
-    glBindVertexArray(_vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-    glBufferData(GL_ARRAY_BUFFER, _vertex_count * sizeof(float), _vertices, GL_STATIC_DRAW);
-
-#ifdef GENERATE_NORMALS
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-        true_floats_per_line * sizeof(float), (void*) 0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-        true_floats_per_line * sizeof(float), (void*) (3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
-        true_floats_per_line * sizeof(float), (void*) (6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE,
-        true_floats_per_line * sizeof(float), (void*) (8 * sizeof(float)));
-    glEnableVertexAttribArray(3);
-#else
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-        floats_per_line * sizeof(float), (void*) 0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-        floats_per_line * sizeof(float), (void*) (3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
-        floats_per_line * sizeof(float), (void*) (6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE,
-        floats_per_line * sizeof(float), (void*) (8 * sizeof(float)));
-    glEnableVertexAttribArray(3);
-#endif // GENERATE_NORMALS
+    return mesh;
 }
 
-CsvModel::~CsvModel()
+void CsvModel::compute_bounds(CsvMesh& mesh)
 {
-    if (_vertices != nullptr)
-        delete[] _vertices;
-}
-
-void CsvModel::render(glm::mat4 model, glm::mat4 view, glm::mat4 projection)
-{
-    if (_vertex_count == 0 || _vertices == nullptr)
-        throw std::runtime_error("tried to render a moved csv model");
-
-    auto shader_id = _shader->id();
-
-    _texture->bind(0);
-
-    auto model_loc = glGetUniformLocation(shader_id, "model");
-    auto view_loc = glGetUniformLocation(shader_id, "view");
-    auto projection_loc = glGetUniformLocation(shader_id, "projection");
+    constexpr int stride = floats_per_vertex;
 
-    auto texture_loc = glGetUniformLocation(shader_id, "main_texture");
+    auto& vertices = mesh.vertices;
+    auto count = static_cast<int>(vertices.size());
 
-    glUniform1i(texture_loc, 0);
-    glUniformMatrix4fv(model_loc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(view_loc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projection_loc, 1, GL_FALSE, glm::value_ptr(projection));
-
-    glBindVertexArray(_vao);
-    glDrawArrays(GL_TRIANGLES, 0, _vertex_count);
-}
-
-void CsvModel::render_sun(glm::mat4 model, glm::mat4 view, glm::mat4 projection)
-{
-    if (_vertex_count == 0 || _vertices == nullptr)
-        throw std::runtime_error("tried to render a moved csv model");
-
-    auto shader_id = _shader->id();
-
-    auto model_loc = glGetUniformLocation(shader_id, "model");
-    auto view_loc = glGetUniformLocation(shader_id, "view");
-    auto projection_loc = glGetUniformLocation(shader_id, "projection");
+    if (count < stride)
+    {
+        mesh.bounds = Bounds();
+        return;
+    }
 
-    glUniformMatrix4fv(model_loc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(view_loc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projection_loc, 1, GL_FALSE, glm::value_ptr(projection));
+    mesh.bounds.min = glm::vec3(vertices[0], vertices[1], vertices[2]);
+    mesh.bounds.max = mesh.bounds.min;
 
-    glBindVertexArray(_vao);
-    glDrawArrays(GL_TRIANGLES, 0, _vertex_count);
+    for (int it = stride; it + 2 < count; it += stride)
+    {
+        glm::vec3 vertex(vertices[it], vertices[it + 1], vertices[it + 2]);
+        mesh.bounds.min = glm::min(mesh.bounds.min, vertex);
+        mesh.bounds.max = glm::max(mesh.bounds.max, vertex);
+    }
 }
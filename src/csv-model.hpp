@@ -2,51 +2,99 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 
-#include <shader.hpp>
 #include <texture.hpp>
+#include <transform.hpp>
 
-// #define GENERATE_NORMALS
+// vertex data read from a csv file, not yet uploaded to the GPU
+struct CsvMesh
+{
+    std::vector<float> vertices;
+    Bounds bounds;
+
+    // false when the file had no normals and they were left at zero
+    bool has_normals = true;
+};
 
+// a mesh loaded from a csv file and the texture it is drawn with. it only
+// holds CPU data, render backends create their own resources from it
 class CsvModel
 {
 public:
+    static constexpr int floats_per_vertex = 11;
+
+    // lines of files without normals
+    static constexpr int floats_without_normals = 8;
+
+    // offsets of each attribute inside a vertex, in floats
+    static constexpr int position_offset = 0;
+    static constexpr int color_offset = 3;
+    static constexpr int tex_coord_offset = 6;
+    static constexpr int normal_offset = 8;
+
     CsvModel(
         const std::string& filename,
-        std::shared_ptr<ShaderProgram> shader,
         std::shared_ptr<Texture> texture);
 
-    CsvModel(const CsvModel& other) = delete;
-    CsvModel(CsvModel&& other);
+    CsvModel(
+        CsvMesh mesh,
+        std::shared_ptr<Texture> texture);
 
-    CsvModel& operator = (const CsvModel& other) = delete;
-    CsvModel& operator = (CsvModel&& other);
+    const Bounds& bounds() const
+    {
+        return _mesh.bounds;
+    }
 
-    ~CsvModel();
+    const CsvMesh& mesh() const
+    {
+        return _mesh;
+    }
 
-    void render(glm::mat4 model, glm::mat4 view, glm::mat4 projection);
+    const float* vertices() const
+    {
+        return _mesh.vertices.data();
+    }
 
-    void render_sun(glm::mat4 model, glm::mat4 view, glm::mat4 projection);
+    int vertex_count() const
+    {
+        return _vertex_count;
+    }
 
-private:
-#ifdef GENERATE_NORMALS
-    static constexpr int file_floats_per_line = 8;
-    static constexpr int true_floats_per_line = 11;
-#else
-    static constexpr int floats_per_line = 11;
-#endif // GENERATE_NORMALS
+    // vertices the current buffer holds without reallocating
+    int vertex_capacity() const
+    {
+        return static_cast<int>(_mesh.vertices.capacity()) / floats_per_vertex;
+    }
 
-    void parse_csv(const std::string& filename);
-    void init_buffers();
+    // bumped every time the vertices are replaced, so backends know when to
+    // upload them again
+    unsigned int version() const
+    {
+        return _version;
+    }
 
-    int _vertex_count;
-    float *_vertices;
+    const Texture* texture() const
+    {
+        return _texture.get();
+    }
+
+    // replaces the vertices with the ones in mesh and hands the old ones
+    // back in it, so both buffers can be reused
+    void swap_mesh(CsvMesh& mesh);
+
+    // only touches the file system, so it is safe to call from any thread
+    static CsvMesh parse_csv(const std::string& filename);
 
-    unsigned int _vao;
-    unsigned int _vbo;
+    // recomputes mesh.bounds from the positions
+    static void compute_bounds(CsvMesh& mesh);
+
+private:
+    CsvMesh _mesh;
+    int _vertex_count;
+    unsigned int _version = 0;
 
-    std::shared_ptr<ShaderProgram> _shader;
     std::shared_ptr<Texture> _texture;
 };
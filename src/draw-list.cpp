@@ -0,0 +1,121 @@
+#include <draw-list.hpp>
+
+#include <algorithm>
+
+Frustum extract_frustum(const glm::mat4& view_projection)
+{
+    auto row = [&](int i) {
+        return glm::vec4(
+            view_projection[0][i],
+            view_projection[1][i],
+            view_projection[2][i],
+            view_projection[3][i]);
+    };
+
+    Frustum frustum;
+    frustum.planes[0] = row(3) + row(0);
+    frustum.planes[1] = row(3) - row(0);
+    frustum.planes[2] = row(3) + row(1);
+    frustum.planes[3] = row(3) - row(1);
+    frustum.planes[4] = row(3) + row(2);
+    frustum.planes[5] = row(3) - row(2);
+
+    return frustum;
+}
+
+bool intersects(const Frustum& frustum, const Bounds& bounds)
+{
+    for (auto& plane: frustum.planes)
+    {
+        // the corner furthest along the plane normal
+        glm::vec3 corner(
+            plane.x > 0.0f ? bounds.max.x : bounds.min.x,
+            plane.y > 0.0f ? bounds.max.y : bounds.min.y,
+            plane.z > 0.0f ? bounds.max.z : bounds.min.z);
+
+        if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+static std::uint64_t make_sort_key(
+    const CsvModel& model, ShadingModel shading, float depth)
+{
+    constexpr float max_depth = 100.0f;
+    constexpr std::uint64_t depth_steps = (1u << 24) - 1;
+
+    auto texture = model.texture();
+    std::uint64_t texture_id = texture == nullptr ? 0 : texture->id() & 0xffffff;
+    std::uint64_t shading_id = static_cast<std::uint64_t>(shading);
+
+    auto normalized = std::min(std::max(depth / max_depth, 0.0f), 1.0f);
+    auto depth_bits = static_cast<std::uint64_t>(normalized * depth_steps);
+
+    return (shading_id << 56) | (texture_id << 32) | depth_bits;
+}
+
+void DrawList::build(
+    JobSystem& jobs,
+    FrameArena& arena,
+    const std::vector<glm::mat4>& world,
+    const std::vector<Bounds>& world_bounds,
+    const Renderable* renderables,
+    std::size_t count,
+    const glm::mat4& view,
+    const glm::mat4& projection)
+{
+    auto visible = arena.allocate<std::uint8_t>(count);
+    auto candidates = arena.allocate<DrawCommand>(count);
+
+    auto frustum = extract_frustum(projection * view);
+
+    jobs.parallel_for(count, batch_size, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++)
+        {
+            auto& renderable = renderables[i];
+            auto in_world_space = renderable.entity == no_entity;
+            auto& bounds = in_world_space
+                ? renderable.model->bounds()
+                : world_bounds[renderable.entity];
+
+            visible[i] = intersects(frustum, bounds);
+
+            if (!visible[i])
+                continue;
+
+            auto center = (bounds.min + bounds.max) * 0.5f;
+            auto depth = -(view * glm::vec4(center, 1.0f)).z;
+
+            auto& command = candidates[i];
+            command.key = make_sort_key(*renderable.model, renderable.shading, depth);
+            command.model = renderable.model;
+            command.shading = renderable.shading;
+            command.world = in_world_space ? glm::mat4(1.0f) : world[renderable.entity];
+        }
+    });
+
+    auto keys = arena.allocate<SortKey>(count);
+    std::size_t size = 0;
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (visible[i])
+            keys[size++] = SortKey { candidates[i].key, i };
+    }
+
+    // the index breaks ties, so equal keys keep the order of the renderables
+    std::sort(keys, keys + size,
+        [](const SortKey& a, const SortKey& b) {
+            return a.key < b.key || (a.key == b.key && a.index < b.index);
+        });
+
+    auto commands = arena.allocate<DrawCommand>(size);
+
+    for (std::size_t i = 0; i < size; i++)
+        commands[i] = candidates[keys[i].index];
+
+    _commands = commands;
+    _size = size;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <csv-model.hpp>
+#include <frame-arena.hpp>
+#include <job-system.hpp>
+#include <scene.hpp>
+#include <transform.hpp>
+
+// the shading models of the shaders in shaders/
+enum class ShadingModel : std::uint8_t
+{
+    phong,
+    sun
+};
+
+struct Renderable
+{
+    // no_entity for models whose vertices are already in world space
+    Entity entity;
+    CsvModel* model;
+    ShadingModel shading;
+};
+
+struct DrawCommand
+{
+    // shading model and texture in the high bits, view depth in the low
+    // ones, so sorting groups state changes and draws front to back within
+    // a group
+    std::uint64_t key;
+    CsvModel* model;
+    ShadingModel shading;
+    glm::mat4 world;
+};
+
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+Frustum extract_frustum(const glm::mat4& view_projection);
+
+bool intersects(const Frustum& frustum, const Bounds& bounds);
+
+// culls the renderables and produces the sorted list of draws the GL thread
+// consumes. the culling results, the sort keys and the draws all live in the
+// frame arena, so the list is valid until the arena is reset
+class DrawList
+{
+public:
+    // world and world_bounds are indexed by entity
+    void build(
+        JobSystem& jobs,
+        FrameArena& arena,
+        const std::vector<glm::mat4>& world,
+        const std::vector<Bounds>& world_bounds,
+        const Renderable* renderables,
+        std::size_t count,
+        const glm::mat4& view,
+        const glm::mat4& projection);
+
+    const DrawCommand* commands() const
+    {
+        return _commands;
+    }
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+private:
+    static constexpr std::size_t batch_size = 256;
+
+    // sorted instead of the commands, which are five times bigger
+    struct SortKey
+    {
+        std::uint64_t key;
+        std::size_t index;
+    };
+
+    const DrawCommand* _commands = nullptr;
+    std::size_t _size = 0;
+};
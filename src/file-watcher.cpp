@@ -0,0 +1,90 @@
+#include <file-watcher.hpp>
+
+#include <system_error>
+
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(const std::string& filename) :
+    _path(std::filesystem::absolute(filename))
+{
+    std::error_code error;
+    _last_write = std::filesystem::last_write_time(_path, error);
+
+#ifdef __linux__
+    _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (_fd >= 0)
+    {
+        auto folder = _path.parent_path().string();
+        _watch = inotify_add_watch(_fd, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+        if (_watch < 0)
+        {
+            close(_fd);
+            _fd = -1;
+        }
+    }
+
+    if (_fd < 0)
+        spdlog::warn("inotify is not available, polling \"{}\" instead", _path.string());
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (_fd >= 0)
+        close(_fd);
+#endif
+}
+
+bool FileWatcher::changed()
+{
+    auto changed = false;
+
+#ifdef __linux__
+    if (_fd >= 0)
+    {
+        alignas(inotify_event) char buffer[4096];
+        auto name = _path.filename().string();
+
+        // drains every pending event, the folder can see many other files
+        // written between two calls
+        while (true)
+        {
+            auto size = read(_fd, buffer, sizeof(buffer));
+
+            if (size <= 0)
+                break;
+
+            for (ssize_t offset = 0; offset < size;)
+            {
+                auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+
+                if (event->len > 0 && name == event->name)
+                    changed = true;
+
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        return changed;
+    }
+#endif
+
+    std::error_code error;
+    auto last_write = std::filesystem::last_write_time(_path, error);
+
+    if (!error && last_write != _last_write)
+    {
+        _last_write = last_write;
+        changed = true;
+    }
+
+    return changed;
+}
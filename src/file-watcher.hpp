@@ -0,0 +1,30 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+// tells when a file was written. on linux it watches the folder the file is
+// in with inotify, so editors that save through a rename are seen too,
+// elsewhere it compares the modification time
+class FileWatcher
+{
+public:
+    explicit FileWatcher(const std::string& filename);
+
+    FileWatcher(const FileWatcher& other) = delete;
+    FileWatcher& operator = (const FileWatcher& other) = delete;
+
+    ~FileWatcher();
+
+    // true once for all the writes since the last call, never blocks
+    bool changed();
+
+private:
+    std::filesystem::path _path;
+
+    // inotify instance and watch, -1 when polling the modification time
+    int _fd = -1;
+    int _watch = -1;
+
+    std::filesystem::file_time_type _last_write;
+};
@@ -0,0 +1,63 @@
+#include <frame-arena.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+FrameArena::FrameArena(std::size_t capacity) :
+    _capacity(std::max<std::size_t>(capacity, 1)),
+    _block(std::make_unique<unsigned char[]>(_capacity))
+{
+}
+
+void FrameArena::reset()
+{
+    if (!_overflow.empty())
+    {
+        auto needed = _used + _overflow_bytes;
+
+        while (_capacity < needed)
+            _capacity *= 2;
+
+        _overflow.clear();
+        _block = std::make_unique<unsigned char[]>(_capacity);
+
+        spdlog::info("frame arena grown to {} KB", _capacity / 1024);
+    }
+
+    _used = 0;
+    _overflow_bytes = 0;
+}
+
+void* FrameArena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        spdlog::error("frame arena alignment must be a power of two, got {}", alignment);
+        throw std::invalid_argument("invalid frame arena alignment");
+    }
+
+    // the block is only as aligned as new makes it, so the address is what
+    // gets aligned
+    auto base = reinterpret_cast<std::uintptr_t>(_block.get());
+    auto start = ((base + _used + alignment - 1) & ~(alignment - 1)) - base;
+
+    if (start + bytes <= _capacity)
+    {
+        _used = start + bytes;
+        _peak = std::max(_peak, used());
+
+        return _block.get() + start;
+    }
+
+    // the padding leaves room to align inside the spilled allocation
+    auto size = bytes + alignment - 1;
+    _overflow.push_back(std::make_unique<unsigned char[]>(size));
+    _overflow_bytes += size;
+    _peak = std::max(_peak, used());
+
+    auto spilled = reinterpret_cast<std::uintptr_t>(_overflow.back().get());
+    return reinterpret_cast<void*>((spilled + alignment - 1) & ~(alignment - 1));
+}
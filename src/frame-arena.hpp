@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// linear allocator for the data that only lives for one frame, like the
+// culling results and the draw list. allocating is a pointer bump and the
+// whole frame is freed at once by reset. a frame that does not fit spills to
+// the heap, and the next reset grows the block to what that frame needed, so
+// a steady frame stops allocating. only the thread that owns it may allocate
+class FrameArena
+{
+public:
+    explicit FrameArena(std::size_t capacity = 64 * 1024);
+
+    FrameArena(const FrameArena& other) = delete;
+    FrameArena& operator = (const FrameArena& other) = delete;
+
+    // forgets every allocation, whatever they point to is reused from here
+    void reset();
+
+    // alignment must be a power of two
+    void* allocate(std::size_t bytes, std::size_t alignment);
+
+    // default constructed, which leaves trivial types uninitialized. the
+    // arena never runs destructors
+    template <typename T>
+    T* allocate(std::size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value,
+            "frame arena objects are never destroyed");
+
+        auto data = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        std::uninitialized_default_construct_n(data, count);
+
+        return data;
+    }
+
+    std::size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    // bytes of the current frame, counting what spilled
+    std::size_t used() const
+    {
+        return _used + _overflow_bytes;
+    }
+
+    // most bytes a frame used
+    std::size_t peak() const
+    {
+        return _peak;
+    }
+
+private:
+    std::size_t _capacity;
+    std::unique_ptr<unsigned char[]> _block;
+    std::size_t _used = 0;
+
+    // allocations that did not fit the block, freed on reset
+    std::vector<std::unique_ptr<unsigned char[]>> _overflow;
+    std::size_t _overflow_bytes = 0;
+
+    std::size_t _peak = 0;
+};
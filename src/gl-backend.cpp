@@ -0,0 +1,472 @@
+#include <gl-backend.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include <GL/glew.h>
+#include <spdlog/spdlog.h>
+
+static std::size_t uniform_buffer_alignment()
+{
+    int alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    return static_cast<std::size_t>(std::max(alignment, 16));
+}
+
+GlBackend::GlBackend(
+    const std::string& phong_vert_filename,
+    const std::string& phong_frag_filename,
+    const std::string& sun_vert_filename,
+    const std::string& sun_frag_filename,
+    const DynamicResolutionSettings& dynamic_resolution,
+    TextureStreamer* streamer)
+    : _phong(phong_vert_filename, phong_frag_filename),
+      _sun(sun_vert_filename, sun_frag_filename),
+      _constants(GL_UNIFORM_BUFFER, uniform_buffer_alignment(), frames_in_flight),
+      _streamer(streamer)
+{
+    bind_blocks(_phong);
+    bind_blocks(_sun);
+
+    glEnable(GL_DEPTH_TEST);
+
+    spdlog::info("frame constants stream through a {} buffer, {} frames in flight",
+        _constants.persistent() ? "persistently mapped" : "unsynchronized mapped", frames_in_flight);
+
+    // rows of RGB images, and of their small mips, are not padded to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (dynamic_resolution.enabled)
+    {
+        _resolution = std::make_unique<ResolutionController>(dynamic_resolution);
+        glGenQueries(timer_query_count, _timer_queries);
+
+        spdlog::info("dynamic resolution between {:.2f} and {:.2f} of the window, targeting {:.2f} ms",
+            dynamic_resolution.min_scale, dynamic_resolution.max_scale, dynamic_resolution.target_ms);
+    }
+}
+
+GlBackend::~GlBackend()
+{
+    auto& stats = _constants.stats();
+
+    spdlog::info("frame constants: {} frames, {} waited for the GPU for {:.2f} ms ({:.2f} ms at most), "
+        "{} KB per frame at most",
+        stats.frames, stats.stalls, stats.stall_ms, stats.max_stall_ms, stats.peak_bytes / 1024);
+
+    if (_resolution)
+    {
+        delete_target();
+        glDeleteQueries(timer_query_count, _timer_queries);
+    }
+
+    for (auto& entry: _meshes)
+    {
+        glDeleteBuffers(1, &entry.second.vbo);
+        glDeleteVertexArrays(1, &entry.second.vao);
+    }
+
+    for (auto& entry: _textures)
+        glDeleteTextures(1, &entry.second);
+}
+
+void GlBackend::release(const CsvModel& model)
+{
+    auto it = _meshes.find(&model);
+
+    if (it == _meshes.end())
+        return;
+
+    glDeleteBuffers(1, &it->second.vbo);
+    glDeleteVertexArrays(1, &it->second.vao);
+    _meshes.erase(it);
+}
+
+void GlBackend::release(const Texture& texture)
+{
+    if (_streamer != nullptr)
+        _streamer->release(texture);
+
+    auto it = _textures.find(&texture);
+
+    if (it == _textures.end())
+        return;
+
+    glDeleteTextures(1, &it->second);
+    _textures.erase(it);
+}
+
+void GlBackend::bind_blocks(const ShaderProgram& program)
+{
+    auto id = program.id();
+
+    auto frame = glGetUniformBlockIndex(id, "Frame");
+    auto draw = glGetUniformBlockIndex(id, "Draw");
+
+    if (frame != GL_INVALID_INDEX)
+        glUniformBlockBinding(id, frame, frame_block);
+
+    if (draw != GL_INVALID_INDEX)
+        glUniformBlockBinding(id, draw, draw_block);
+
+    // samplers keep their unit, so it is only set once
+    program.use();
+    glUniform1i(glGetUniformLocation(id, "main_texture"), 0);
+}
+
+const GlBackend::GlMesh& GlBackend::mesh_for(const CsvModel& model)
+{
+    auto it = _meshes.find(&model);
+
+    if (it != _meshes.end())
+    {
+        // models whose vertices were swapped keep their buffer
+        if (it->second.version != model.version())
+            upload(model, it->second);
+
+        return it->second;
+    }
+
+    GlMesh mesh;
+    mesh.vertex_count = 0;
+    mesh.capacity = 0;
+
+    glGenVertexArrays(1, &mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
+
+    glBindVertexArray(mesh.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+
+    constexpr auto stride = CsvModel::floats_per_vertex * sizeof(float);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+        stride, (void*) (CsvModel::position_offset * sizeof(float)));
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
+        stride, (void*) (CsvModel::color_offset * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
+        stride, (void*) (CsvModel::tex_coord_offset * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE,
+        stride, (void*) (CsvModel::normal_offset * sizeof(float)));
+    glEnableVertexAttribArray(3);
+
+    upload(model, mesh);
+
+    return _meshes.emplace(&model, mesh).first->second;
+}
+
+void GlBackend::upload(const CsvModel& model, GlMesh& mesh)
+{
+    constexpr auto vertex_size = CsvModel::floats_per_vertex * sizeof(float);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+
+    // the buffer is sized for the whole capacity of the model, so models
+    // that are rebuilt in place only ever reallocate it once
+    if (model.vertex_count() > mesh.capacity)
+    {
+        mesh.capacity = std::max(model.vertex_capacity(), model.vertex_count());
+        auto usage = model.version() == 0 ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
+        glBufferData(GL_ARRAY_BUFFER, mesh.capacity * vertex_size, nullptr, usage);
+    }
+
+    glBufferSubData(GL_ARRAY_BUFFER, 0,
+        model.vertex_count() * vertex_size, model.vertices());
+
+    mesh.vertex_count = model.vertex_count();
+    mesh.version = model.version();
+}
+
+unsigned int GlBackend::texture_for(const Texture& texture)
+{
+    auto it = _textures.find(&texture);
+
+    if (it != _textures.end())
+        return it->second;
+
+    unsigned int id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    auto& image = texture.image();
+    auto tp = image.channels == 3 ? GL_RGB : GL_RGBA;
+
+    // streamed textures start at the level their image is, the finer levels
+    // are only defined once the streamer reads them
+    auto level = 0;
+
+    if (texture.streamed())
+    {
+        auto& source = texture.mip_source();
+        level = source.level;
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, source.levels - 1);
+    }
+
+    glTexImage2D(
+        GL_TEXTURE_2D, level, tp, image.width, image.height,
+        0, tp, GL_UNSIGNED_BYTE, image.pixels.get());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    _textures.emplace(&texture, id);
+    return id;
+}
+
+void GlBackend::apply(const MipUpdate& update)
+{
+    auto it = _textures.find(update.texture);
+
+    if (it == _textures.end())
+        return;
+
+    auto tp = update.texture->image().channels == 3 ? GL_RGB : GL_RGBA;
+    glBindTexture(GL_TEXTURE_2D, it->second);
+
+    if (update.level < update.previous_level)
+    {
+        for (std::size_t i = 0; i < update.images.size(); i++)
+        {
+            auto& image = update.images[i];
+
+            glTexImage2D(
+                GL_TEXTURE_2D, update.level + static_cast<int>(i), tp, image.width, image.height,
+                0, tp, GL_UNSIGNED_BYTE, image.pixels.get());
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, update.level);
+    }
+    else
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, update.level);
+
+        // empty levels give their memory back to the driver
+        for (auto level = update.previous_level; level < update.level; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, tp, 0, 0, 0, tp, GL_UNSIGNED_BYTE, nullptr);
+    }
+}
+
+void GlBackend::set_framebuffer_size(int width, int height)
+{
+    if (width == _framebuffer_width && height == _framebuffer_height)
+        return;
+
+    _framebuffer_width = width;
+    _framebuffer_height = height;
+
+    if (_resolution)
+        resize_target();
+}
+
+void GlBackend::delete_target()
+{
+    glDeleteFramebuffers(1, &_target.framebuffer);
+    glDeleteTextures(1, &_target.color);
+    glDeleteRenderbuffers(1, &_target.depth);
+
+    _target = RenderTarget();
+}
+
+void GlBackend::resize_target()
+{
+    delete_target();
+
+    auto max_scale = _resolution->settings().max_scale;
+    _target.width = std::max(static_cast<int>(std::ceil(_framebuffer_width * max_scale)), 1);
+    _target.height = std::max(static_cast<int>(std::ceil(_framebuffer_height * max_scale)), 1);
+
+    glGenTextures(1, &_target.color);
+    glBindTexture(GL_TEXTURE_2D, _target.color);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _target.width, _target.height,
+        0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glGenRenderbuffers(1, &_target.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, _target.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _target.width, _target.height);
+
+    glGenFramebuffers(1, &_target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _target.color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _target.depth);
+
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        spdlog::error("dynamic resolution target is incomplete, status = {}", status);
+        throw std::logic_error("incomplete framebuffer");
+    }
+}
+
+void GlBackend::read_timer_queries()
+{
+    // oldest first, so the controller sees the frames in order
+    for (int i = 0; i < timer_query_count; i++)
+    {
+        auto index = (_next_timer + i) % timer_query_count;
+
+        if (!_timer_pending[index])
+            continue;
+
+        int available = 0;
+        glGetQueryObjectiv(_timer_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+            break;
+
+        std::uint64_t nanoseconds = 0;
+        glGetQueryObjectui64v(_timer_queries[index], GL_QUERY_RESULT, &nanoseconds);
+        _timer_pending[index] = false;
+
+        _resolution->add_sample(nanoseconds / 1e6);
+    }
+}
+
+void GlBackend::draw_frame(const FrameData& frame)
+{
+    if (!_resolution)
+    {
+        _viewport_height = _framebuffer_height;
+        draw_commands(frame);
+        return;
+    }
+
+    read_timer_queries();
+
+    // a query still pending here is dropped, the GPU is more than
+    // timer_query_count frames behind
+    auto query = _timer_queries[_next_timer];
+    _timer_pending[_next_timer] = true;
+    _next_timer = (_next_timer + 1) % timer_query_count;
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+
+    auto scale = _resolution->scale();
+    auto width = std::min(std::max(static_cast<int>(std::round(_framebuffer_width * scale)), 1), _target.width);
+    auto height = std::min(std::max(static_cast<int>(std::round(_framebuffer_height * scale)), 1), _target.height);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _target.framebuffer);
+    glViewport(0, 0, width, height);
+    _viewport_height = height;
+
+    draw_commands(frame);
+
+    // bilinear upscale of the used corner of the target to the window
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _target.framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(
+        0, 0, width, height,
+        0, 0, _framebuffer_width, _framebuffer_height,
+        GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, _framebuffer_width, _framebuffer_height);
+
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+void GlBackend::draw_commands(const FrameData& frame)
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // a frame without draws still fences its region of the constants and
+    // ticks the streamer, so both keep counting frames
+    auto commands = frame.commands;
+    auto count = commands != nullptr ? frame.command_count : 0;
+
+    // every constant of the frame is written up front, so the buffer is
+    // ready before the first draw
+    auto frame_size = sizeof(FrameConstants);
+    auto draw_stride = (sizeof(DrawConstants) + _constants.alignment() - 1) & ~(_constants.alignment() - 1);
+
+    _constants.begin_frame(frame_size + _constants.alignment() + count * draw_stride);
+
+    auto frame_constants = _constants.allocate(frame_size);
+    auto& constants = *static_cast<FrameConstants*>(frame_constants.data);
+    constants.view = frame.view;
+    constants.projection = frame.projection;
+    constants.light_rot = frame.light_rot;
+    constants.light_pos = glm::vec4(frame.light_pos, 1.0f);
+    constants.light_color = glm::vec4(frame.light_color, 1.0f);
+    constants.view_pos = glm::vec4(frame.view_pos, 1.0f);
+
+    auto draws = _constants.allocate(count * draw_stride);
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        auto data = static_cast<unsigned char*>(draws.data) + i * draw_stride;
+        reinterpret_cast<DrawConstants*>(data)->model = commands[i].world;
+    }
+
+    _constants.flush();
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, frame_block, _constants.id(),
+        frame_constants.offset, sizeof(FrameConstants));
+
+    auto first = true;
+    auto current_shading = ShadingModel::phong;
+
+    // commands come sorted by shading model and texture, so programs are
+    // only switched when the key changes
+    for (std::size_t i = 0; i < count; i++)
+    {
+        auto& command = commands[i];
+
+        if (first || command.shading != current_shading)
+        {
+            first = false;
+            current_shading = command.shading;
+            (current_shading == ShadingModel::phong ? _phong : _sun).use();
+        }
+
+        auto& mesh = mesh_for(*command.model);
+
+        if (command.shading == ShadingModel::phong && command.model->texture() != nullptr)
+        {
+            auto& texture = *command.model->texture();
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, texture_for(texture));
+
+            if (_streamer != nullptr && texture.streamed())
+            {
+                _streamer->request(texture, screen_size(
+                    command.model->bounds(), command.world,
+                    frame.view, frame.projection, _viewport_height));
+            }
+        }
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, draw_block, _constants.id(),
+            draws.offset + i * draw_stride, sizeof(DrawConstants));
+
+        glBindVertexArray(mesh.vao);
+        glDrawArrays(GL_TRIANGLES, 0, mesh.vertex_count);
+    }
+
+    _constants.end_frame();
+
+    // the levels read for this frame show from the next one
+    if (_streamer != nullptr)
+    {
+        for (auto& update: _streamer->update())
+            apply(update);
+    }
+}
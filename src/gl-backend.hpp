@@ -0,0 +1,141 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include <csv-model.hpp>
+#include <render-backend.hpp>
+#include <resolution-controller.hpp>
+#include <settings.hpp>
+#include <shader.hpp>
+#include <stream-buffer.hpp>
+#include <texture.hpp>
+#include <texture-streamer.hpp>
+
+// draws through OpenGL, needs a current context for its whole lifetime.
+// streamed textures get their levels from the streamer, which must outlive
+// the backend
+class GlBackend : public RenderBackend
+{
+public:
+    GlBackend(
+        const std::string& phong_vert_filename,
+        const std::string& phong_frag_filename,
+        const std::string& sun_vert_filename,
+        const std::string& sun_frag_filename,
+        const DynamicResolutionSettings& dynamic_resolution = DynamicResolutionSettings(),
+        TextureStreamer* streamer = nullptr);
+
+    GlBackend(const GlBackend& other) = delete;
+    GlBackend& operator = (const GlBackend& other) = delete;
+
+    ~GlBackend();
+
+    const char* name() const override
+    {
+        return "opengl";
+    }
+
+    void draw_frame(const FrameData& frame) override;
+
+    // size of the default framebuffer, what the frame ends up covering
+    void set_framebuffer_size(int width, int height);
+
+    // fraction of the framebuffer size the scene is drawn at, on each axis
+    float render_scale() const
+    {
+        return _resolution ? _resolution->scale() : 1.0f;
+    }
+
+    void release(const CsvModel& model) override;
+    void release(const Texture& texture) override;
+
+private:
+    struct GlMesh
+    {
+        unsigned int vao;
+        unsigned int vbo;
+        int vertex_count;
+        int capacity;
+        unsigned int version;
+    };
+
+    // std140 layouts of the uniform blocks of the shaders
+    struct FrameConstants
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 light_rot;
+        glm::vec4 light_pos;
+        glm::vec4 light_color;
+        glm::vec4 view_pos;
+    };
+
+    struct DrawConstants
+    {
+        glm::mat4 model;
+    };
+
+    // binding points of the blocks
+    static constexpr unsigned int frame_block = 0;
+    static constexpr unsigned int draw_block = 1;
+
+    // frames the CPU may write ahead of the GPU before waiting for it
+    static constexpr int frames_in_flight = 3;
+
+    // offscreen target of the dynamic resolution. it is sized for the
+    // largest scale, so a new scale only changes the viewport
+    struct RenderTarget
+    {
+        unsigned int framebuffer = 0;
+        unsigned int color = 0;
+        unsigned int depth = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    // GPU times are read a few frames late, so reading never waits for the
+    // GPU to catch up
+    static constexpr int timer_query_count = 4;
+
+    static void bind_blocks(const ShaderProgram& program);
+
+    void draw_commands(const FrameData& frame);
+    void resize_target();
+    void delete_target();
+    void read_timer_queries();
+
+    const GlMesh& mesh_for(const CsvModel& model);
+    void upload(const CsvModel& model, GlMesh& mesh);
+    unsigned int texture_for(const Texture& texture);
+    void apply(const MipUpdate& update);
+
+    ShaderProgram _phong;
+    ShaderProgram _sun;
+
+    // the constants of every frame and draw
+    StreamBuffer _constants;
+
+    std::unordered_map<const CsvModel*, GlMesh> _meshes;
+    std::unordered_map<const Texture*, unsigned int> _textures;
+
+    // null when texture streaming is disabled
+    TextureStreamer* _streamer;
+
+    int _framebuffer_width = 0;
+    int _framebuffer_height = 0;
+
+    // height the scene is drawn at, to size textures on screen
+    int _viewport_height = 0;
+
+    // null when dynamic resolution is disabled
+    std::unique_ptr<ResolutionController> _resolution;
+    RenderTarget _target;
+
+    unsigned int _timer_queries[timer_query_count] = {};
+    bool _timer_pending[timer_query_count] = {};
+    int _next_timer = 0;
+};
@@ -0,0 +1,343 @@
+#include <job-system.hpp>
+
+#include <cstdint>
+
+// the worker the current thread belongs to, if any
+static thread_local JobSystem* current_system = nullptr;
+static thread_local unsigned int current_index = 0;
+
+// fixed capacity Chase-Lev deque. the owner pushes and pops at the bottom,
+// thieves take from the top. slots are made of atomics so a thief reading a
+// slot the owner is rewriting is not a data race, the CAS on top decides
+// which of them gets the job
+class WorkStealingQueue
+{
+public:
+    static constexpr std::int64_t capacity = 4096;
+
+    WorkStealingQueue()
+        : _slots(new Slot[capacity])
+    {
+    }
+
+    bool push(const Job& job)
+    {
+        auto bottom = _bottom.load(std::memory_order_relaxed);
+        auto top = _top.load(std::memory_order_acquire);
+
+        if (bottom - top >= capacity)
+            return false;
+
+        store(bottom, job);
+        std::atomic_thread_fence(std::memory_order_release);
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    bool pop(Job& job)
+    {
+        auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+        _bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = _top.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        load(bottom, job);
+
+        if (top == bottom)
+        {
+            // last job, race the thieves for it
+            bool won = _top.compare_exchange_strong(
+                top, top + 1,
+                std::memory_order_seq_cst,
+                std::memory_order_relaxed);
+
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    bool steal(Job& job)
+    {
+        auto top = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto bottom = _bottom.load(std::memory_order_acquire);
+
+        if (top >= bottom)
+            return false;
+
+        load(top, job);
+
+        return _top.compare_exchange_strong(
+            top, top + 1,
+            std::memory_order_seq_cst,
+            std::memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        return _bottom.load(std::memory_order_relaxed)
+            <= _top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<void (*)(void*, std::size_t, std::size_t)> function;
+        std::atomic<void*> data;
+        std::atomic<std::size_t> begin;
+        std::atomic<std::size_t> end;
+        std::atomic<JobCounter*> counter;
+        std::atomic<AllocationTag> tag;
+    };
+
+    void store(std::int64_t index, const Job& job)
+    {
+        auto& slot = _slots[index & (capacity - 1)];
+        slot.function.store(job.function, std::memory_order_relaxed);
+        slot.data.store(job.data, std::memory_order_relaxed);
+        slot.begin.store(job.begin, std::memory_order_relaxed);
+        slot.end.store(job.end, std::memory_order_relaxed);
+        slot.counter.store(job.counter, std::memory_order_relaxed);
+        slot.tag.store(job.tag, std::memory_order_relaxed);
+    }
+
+    void load(std::int64_t index, Job& job) const
+    {
+        auto& slot = _slots[index & (capacity - 1)];
+        job.function = slot.function.load(std::memory_order_relaxed);
+        job.data = slot.data.load(std::memory_order_relaxed);
+        job.begin = slot.begin.load(std::memory_order_relaxed);
+        job.end = slot.end.load(std::memory_order_relaxed);
+        job.counter = slot.counter.load(std::memory_order_relaxed);
+        job.tag = slot.tag.load(std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<Slot[]> _slots;
+    alignas(64) std::atomic<std::int64_t> _top { 0 };
+    alignas(64) std::atomic<std::int64_t> _bottom { 0 };
+};
+
+static constexpr std::size_t shared_capacity = 4096;
+static constexpr int spins_before_sleep = 64;
+
+JobSystem::JobSystem(unsigned int thread_count)
+{
+    _shared.resize(shared_capacity);
+
+    // the thread calling wait counts as one of the workers
+    unsigned int worker_count = thread_count > 1 ? thread_count - 1 : 0;
+
+    for (unsigned int i = 0; i < worker_count; i++)
+        _queues.push_back(std::make_unique<WorkStealingQueue>());
+
+    for (unsigned int i = 0; i < worker_count; i++)
+        _workers.emplace_back(&JobSystem::worker_loop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(_sleep_mutex);
+        _stop = true;
+    }
+
+    _wake.notify_all();
+
+    for (auto& worker: _workers)
+        worker.join();
+}
+
+void JobSystem::run(const Job& job, JobCounter& counter)
+{
+    Job queued = job;
+    queued.counter = &counter;
+    queued.tag = current_allocation_tag();
+    counter._pending.fetch_add(1, std::memory_order_relaxed);
+
+    bool queued_ok = false;
+
+    if (current_system == this)
+    {
+        queued_ok = _queues[current_index]->push(queued);
+    }
+    else if (!_workers.empty())
+    {
+        std::lock_guard<std::mutex> lock(_shared_mutex);
+
+        if (_shared_size < shared_capacity)
+        {
+            _shared[(_shared_head + _shared_size) % shared_capacity] = queued;
+            _shared_size++;
+            queued_ok = true;
+        }
+    }
+
+    // with every queue full the job simply runs on the submitting thread
+    if (!queued_ok)
+    {
+        execute(queued);
+        return;
+    }
+
+    wake_one();
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    while (!counter.done())
+    {
+        if (!try_run_one())
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::run_range(void* data, std::size_t begin, std::size_t end)
+{
+    auto task = static_cast<RangeTask*>(data);
+
+    // keep half of the range for ourselves and leave the other half for
+    // whoever is idle, until the batch is small enough
+    while (end - begin > task->batch_size)
+    {
+        auto middle = begin + (end - begin) / 2;
+
+        Job job;
+        job.function = &JobSystem::run_range;
+        job.data = task;
+        job.begin = middle;
+        job.end = end;
+
+        task->system->run(job, *task->counter);
+        end = middle;
+    }
+
+    if (task->failed.load(std::memory_order_relaxed))
+        return;
+
+    try
+    {
+        task->body(task->fn, begin, end);
+    }
+    catch (...)
+    {
+        if (!task->failed.exchange(true))
+            task->error = std::current_exception();
+    }
+}
+
+void JobSystem::worker_loop(unsigned int index)
+{
+    current_system = this;
+    current_index = index;
+
+    int idle_spins = 0;
+
+    while (!_stop.load(std::memory_order_relaxed))
+    {
+        if (try_run_one())
+        {
+            idle_spins = 0;
+            continue;
+        }
+
+        if (++idle_spins < spins_before_sleep)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleep_mutex);
+        _sleeping.fetch_add(1);
+
+        bool has_work;
+        {
+            std::lock_guard<std::mutex> shared_lock(_shared_mutex);
+            has_work = _shared_size > 0;
+        }
+
+        for (auto& queue: _queues)
+            has_work = has_work || !queue->empty();
+
+        if (!has_work && !_stop)
+            _wake.wait(lock);
+
+        _sleeping.fetch_sub(1);
+        idle_spins = 0;
+    }
+
+    current_system = nullptr;
+}
+
+bool JobSystem::try_run_one()
+{
+    Job job;
+
+    if (!find_job(job))
+        return false;
+
+    execute(job);
+    return true;
+}
+
+bool JobSystem::find_job(Job& job)
+{
+    bool is_worker = current_system == this;
+
+    if (is_worker && _queues[current_index]->pop(job))
+        return true;
+
+    {
+        std::lock_guard<std::mutex> lock(_shared_mutex);
+
+        if (_shared_size > 0)
+        {
+            job = _shared[_shared_head];
+            _shared_head = (_shared_head + 1) % shared_capacity;
+            _shared_size--;
+            return true;
+        }
+    }
+
+    auto queue_count = _queues.size();
+    auto start = is_worker ? current_index + 1 : 0;
+
+    for (std::size_t i = 0; i < queue_count; i++)
+    {
+        auto victim = (start + i) % queue_count;
+
+        if (is_worker && victim == current_index)
+            continue;
+
+        if (_queues[victim]->steal(job))
+            return true;
+    }
+
+    return false;
+}
+
+void JobSystem::execute(const Job& job)
+{
+    AllocationScope scope(job.tag);
+    job.function(job.data, job.begin, job.end);
+    job.counter->_pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::wake_one()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (_sleeping.load() == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(_sleep_mutex);
+    _wake.notify_one();
+}
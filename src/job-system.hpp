@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <allocation-tracker.hpp>
+
+class JobSystem;
+class WorkStealingQueue;
+
+// counts the jobs still pending in a group, wait() returns once it hits zero
+class JobCounter
+{
+public:
+    bool done() const
+    {
+        return _pending.load(std::memory_order_acquire) == 0;
+    }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> _pending { 0 };
+};
+
+struct Job
+{
+    void (*function)(void* data, std::size_t begin, std::size_t end) = nullptr;
+    void* data = nullptr;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    JobCounter* counter = nullptr;
+
+    // set by run() to the subsystem of the submitting thread
+    AllocationTag tag = AllocationTag::other;
+};
+
+// every worker owns a deque it pushes and pops at the bottom, idle workers
+// steal from the top of the others. threads that are not workers submit
+// through a shared queue and help running jobs while they wait
+class JobSystem
+{
+public:
+    explicit JobSystem(unsigned int thread_count = std::thread::hardware_concurrency());
+
+    JobSystem(const JobSystem& other) = delete;
+    JobSystem& operator = (const JobSystem& other) = delete;
+
+    ~JobSystem();
+
+    void run(const Job& job, JobCounter& counter);
+    void wait(JobCounter& counter);
+
+    // splits [0, count) in batches of at most batch_size and calls
+    // fn(begin, end) on each of them. blocks until every batch ran and
+    // rethrows the first exception thrown by fn
+    template <typename Fn>
+    void parallel_for(std::size_t count, std::size_t batch_size, Fn&& fn);
+
+    // number of threads running jobs, counting the one that waits
+    unsigned int thread_count() const
+    {
+        return static_cast<unsigned int>(_workers.size()) + 1;
+    }
+
+private:
+    struct RangeTask
+    {
+        void (*body)(void* fn, std::size_t begin, std::size_t end);
+        void* fn;
+        std::size_t batch_size;
+        JobSystem* system;
+        JobCounter* counter;
+        std::atomic<bool> failed { false };
+        std::exception_ptr error;
+    };
+
+    static void run_range(void* data, std::size_t begin, std::size_t end);
+
+    void worker_loop(unsigned int index);
+    bool try_run_one();
+    bool find_job(Job& job);
+    void execute(const Job& job);
+    void wake_one();
+
+    std::vector<std::unique_ptr<WorkStealingQueue>> _queues;
+    std::vector<std::thread> _workers;
+
+    // jobs submitted from threads that are not workers
+    std::mutex _shared_mutex;
+    std::vector<Job> _shared;
+    std::size_t _shared_head = 0;
+    std::size_t _shared_size = 0;
+
+    std::mutex _sleep_mutex;
+    std::condition_variable _wake;
+    std::atomic<int> _sleeping { 0 };
+    std::atomic<bool> _stop { false };
+};
+
+template <typename Fn>
+void JobSystem::parallel_for(std::size_t count, std::size_t batch_size, Fn&& fn)
+{
+    if (count == 0)
+        return;
+
+    if (batch_size == 0)
+        batch_size = 1;
+
+    if (_workers.empty() || count <= batch_size)
+    {
+        fn(std::size_t(0), count);
+        return;
+    }
+
+    using FnType = typename std::remove_reference<Fn>::type;
+
+    JobCounter counter;
+    RangeTask task;
+    task.body = [](void* f, std::size_t begin, std::size_t end) {
+        (*static_cast<FnType*>(f))(begin, end);
+    };
+    task.fn = const_cast<void*>(static_cast<const void*>(&fn));
+    task.batch_size = batch_size;
+    task.system = this;
+    task.counter = &counter;
+
+    Job job;
+    job.function = &JobSystem::run_range;
+    job.data = &task;
+    job.begin = 0;
+    job.end = count;
+
+    run(job, counter);
+    wait(counter);
+
+    if (task.error)
+        std::rethrow_exception(task.error);
+}
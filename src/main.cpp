@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <fmt/format.h>
@@ -6,18 +12,32 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
 #include <spdlog/spdlog.h>
 
+#include <allocation-tracker.hpp>
 #include <camera.hpp>
-#include <csv-model.hpp>
+#include <draw-list.hpp>
+#include <frame-arena.hpp>
+#include <gl-backend.hpp>
+#include <job-system.hpp>
+#include <ray-caster.hpp>
+#include <scene.hpp>
+#include <scene-assets.hpp>
 #include <settings.hpp>
-#include <shader.hpp>
-#include <texture.hpp>
+#include <simulation.hpp>
+#include <software-backend.hpp>
+#include <terrain.hpp>
+#include <texture-streamer.hpp>
 
 constexpr int window_width = 800;
 constexpr int window_height = 600;
 
+constexpr int default_software_frames = 1;
+
+const std::string settings_filename = "settings.json";
+
+const glm::vec3 light_color(1.0f, 1.0f, 0.58f);
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
@@ -35,40 +55,221 @@ void opengl_message_callback(
         type, severity, message);
 }
 
-void process_input(GLFWwindow* window, Camera& camera)
+std::uint32_t process_input(GLFWwindow* window)
 {
+    std::uint32_t actions = 0;
+
     if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
     if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.move_front();
+        actions |= input_move_front;
 
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.move_back();
+        actions |= input_move_back;
 
     if(glfwGetKey(window, GLFW_KEY_A)== GLFW_PRESS)
-        camera.move_left();
+        actions |= input_move_left;
 
     if (glfwGetKey(window, GLFW_KEY_D)== GLFW_PRESS)
-        camera.move_right();
+        actions |= input_move_right;
 
     if(glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
-        camera.turn(0.0f,1.0f);
+        actions |= input_turn_up;
 
     if(glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
-        camera.turn(0.0f,-1.0f);
+        actions |= input_turn_down;
 
     if(glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS)
-        camera.turn(-1.0f, 0.0f);
+        actions |= input_turn_left;
 
     if(glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS)
-        camera.turn(1.0f, 0.0f);
+        actions |= input_turn_right;
+
+    return actions;
+}
+
+Camera default_camera()
+{
+    return Camera(
+        glm::vec3(0.0f, 0.0f, 3.0f),
+        glm::vec3(0.0f, 0.0f, -1.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f));
 }
 
-int main()
+// culls and sorts the snapshot into draw_list and describes the frame. what
+// it describes lives in arena, which must not be reset until it is drawn
+FrameData prepare_frame(
+    JobSystem& jobs, const Snapshot& snapshot, SceneAssets& assets,
+    float aspect, FrameArena& arena, DrawList& draw_list)
 {
-    auto settings = load_settings("settings.json");
+    FrameData frame;
+
+    frame.view = glm::lookAt(
+        snapshot.camera_pos,
+        snapshot.camera_pos + snapshot.camera_front,
+        snapshot.camera_up);
+
+    frame.projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+    frame.view_pos = snapshot.camera_pos;
+
+    frame.light_pos = light_pos;
+    frame.light_rot = snapshot.world[assets.light_pivot];
+    frame.light_color = light_color;
+
+    if (assets.terrain)
+    {
+        AllocationScope scope(AllocationTag::terrain);
+        assets.terrain->update(snapshot.camera_pos);
+    }
+
+    AllocationScope scope(AllocationTag::draw_list);
+
+    // the objects and the terrain chunks of this frame
+    auto& objects = assets.renderables;
+    auto chunk_count = assets.terrain ? assets.terrain->renderables().size() : 0;
+    auto count = objects.size() + chunk_count;
+
+    auto renderables = arena.allocate<Renderable>(count);
+    std::copy(objects.begin(), objects.end(), renderables);
+
+    if (assets.terrain)
+    {
+        auto& chunks = assets.terrain->renderables();
+        std::copy(chunks.begin(), chunks.end(), renderables + objects.size());
+    }
+
+    draw_list.build(
+        jobs, arena, snapshot.world, snapshot.world_bounds,
+        renderables, count, frame.view, frame.projection);
+
+    frame.commands = draw_list.commands();
+    frame.command_count = draw_list.size();
+    return frame;
+}
+
+// casts the camera ray and logs what it hits, the ground below it and
+// whether the sun can see it
+void log_pick(const SceneAssets& assets,
+    const RayCaster& ray_caster, const Snapshot& snapshot)
+{
+    Ray ray;
+    ray.origin = snapshot.camera_pos;
+    ray.direction = snapshot.camera_front;
+
+    auto hit = ray_caster.cast(ray, snapshot.world, snapshot.world_bounds);
+
+    if (!hit.hit)
+    {
+        spdlog::info("picked nothing");
+        return;
+    }
+
+    // the first renderables are the objects of the settings, in order
+    auto name = hit.renderable == WorldHit::no_renderable
+        ? std::string("terrain")
+        : assets.objects[hit.renderable].settings.model;
+
+    auto above = hit.position + glm::vec3(0.0f, 0.01f, 0.0f);
+    auto ground = ray_caster.ground_height(above, snapshot.world, snapshot.world_bounds);
+
+    auto sun = glm::vec3(snapshot.world[assets.sun][3]);
+    auto lit = ray_caster.visible(above, sun, snapshot.world, snapshot.world_bounds);
+
+    spdlog::info("picked {} at ({:.2f}, {:.2f}, {:.2f}), {:.2f} away, ground at {:.2f}, {}",
+        name, hit.position.x, hit.position.y, hit.position.z, hit.distance, ground,
+        lit ? "lit by the sun" : "in shadow");
+}
+
+void log_textures(const TextureStreamer& streamer)
+{
+    spdlog::info("streamed textures: {:.1f} of {:.1f} MB",
+        streamer.resident_bytes() / 1048576.0, streamer.budget_bytes() / 1048576.0);
+
+    for (auto& texture: streamer.residency())
+    {
+        spdlog::info("  {}: level {} of {}, {} wanted {} frames ago{}, {:.2f} MB, {} loads, {} evictions",
+            std::filesystem::path(texture.filename).filename().string(),
+            texture.resident_level, texture.levels, texture.wanted_level, texture.frames_since_used,
+            texture.loading ? ", loading" : "", texture.resident_bytes / 1048576.0,
+            texture.loads, texture.evictions);
+    }
+}
+
+// renders frames of the settings scene to png files without a window or a
+// GPU, one simulation tick per frame
+int render_software(const Settings& settings, const std::string& output_prefix, int frames)
+{
+    JobSystem jobs;
+    Scene scene;
+    SceneAssets assets;
+
+    // the software backend samples the images of the textures, so it needs
+    // them whole
+    auto full_textures = settings;
+    full_textures.texture_streaming.enabled = false;
+
+    load_scene(jobs, full_textures, scene, assets);
 
+    Simulation simulation(jobs, scene, default_camera(), assets.light_pivot, settings.tick_rate);
+    SoftwareBackend backend(jobs, window_width, window_height);
+    FrameArena arena;
+    DrawList draw_list;
+
+    double total_seconds = 0.0;
+
+    for (int i = 0; i < frames; i++)
+    {
+        // saving the image is not part of the frame, so it is not counted
+        auto allocations_before = allocation_counts().allocations;
+        arena.reset();
+
+        simulation.advance();
+
+        auto& snapshots = simulation.snapshots();
+        snapshots.acquire();
+
+        // nothing waits for the ground to stream in between offline frames,
+        // so every frame gets all of it
+        if (assets.terrain)
+        {
+            AllocationScope scope(AllocationTag::terrain);
+            assets.terrain->build_all(snapshots.current().camera_pos);
+        }
+
+        auto frame = prepare_frame(
+            jobs, snapshots.current(), assets,
+            (float) window_width / (float) window_height, arena, draw_list);
+
+        {
+            AllocationScope scope(AllocationTag::backend);
+            backend.draw_frame(frame);
+        }
+
+        auto allocations = allocation_counts().allocations - allocations_before;
+
+        auto filename = fmt::format("{}_{:03}.png", output_prefix, i);
+        backend.save(filename);
+
+        auto& stats = backend.stats();
+        total_seconds += stats.seconds;
+
+        spdlog::info("{}: {} triangles, {} fragments, {:.2f} ms, {} allocations",
+            filename, stats.triangles, stats.fragments, stats.seconds * 1000.0, allocations);
+    }
+
+    auto megapixels = (double) frames * window_width * window_height / 1e6;
+    auto throughput = megapixels / total_seconds;
+    auto cores = jobs.thread_count();
+
+    spdlog::info("software backend: {:.2f} MP/s, {:.2f} MP/s per core on {} cores",
+        throughput, throughput / cores, cores);
+
+    return EXIT_SUCCESS;
+}
+
+int render_window(const Settings& settings)
+{
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -89,6 +290,7 @@ int main()
     }
 
     glfwMakeContextCurrent(window);
+    glfwSwapInterval(settings.vsync ? 1 : 0);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
     if (glewInit() != GLEW_OK)
@@ -103,135 +305,134 @@ int main()
     glEnable(GL_DEBUG_OUTPUT);
     glDebugMessageCallback(opengl_message_callback, 0);
 
-    glEnable(GL_DEPTH_TEST);
-
-    auto vertex_shader_filename = fmt::format(
-        "{}/shaders/{}",
-        settings.root_folder,
-        settings.vertex_shader);
+    auto shader_filename = [&](const std::string& name) {
+        return fmt::format("{}/shaders/{}", settings.root_folder, name);
+    };
 
-    auto fragment_shader_filename = fmt::format(
-        "{}/shaders/{}",
-        settings.root_folder,
-        settings.fragment_shader);
+    JobSystem jobs;
+    Scene scene;
+    SceneAssets assets;
 
-    auto shader = std::make_shared<ShaderProgram>(
-        vertex_shader_filename,
-        fragment_shader_filename);
+    load_scene(jobs, settings, scene, assets);
 
-    std::vector<CsvModel> scene;
+    // the ground around the starting camera is there from the first frame,
+    // the rest streams in as the camera moves
+    if (assets.terrain)
+        assets.terrain->build_all(default_camera().pos());
 
-    for (auto& object: settings.objects)
     {
-        auto texture_filename = fmt::format(
-            "{}/res/{}",
-            settings.root_folder,
-            object.texture);
+        std::unique_ptr<TextureStreamer> streamer;
 
-        auto texture = std::make_shared<Texture>(texture_filename);
+        if (settings.texture_streaming.enabled)
+            streamer = std::make_unique<TextureStreamer>(jobs, settings.texture_streaming);
 
-        auto model_filename = fmt::format(
-            "{}/res/{}",
-            settings.root_folder,
-            object.model);
+        GlBackend backend(
+            shader_filename(settings.vertex_shader),
+            shader_filename(settings.fragment_shader),
+            shader_filename(settings.sun.vertex_shader),
+            shader_filename(settings.sun.fragment_shader),
+            settings.dynamic_resolution,
+            streamer.get());
 
-        scene.emplace_back(
-            model_filename,
-            shader,
-            texture);
+        FrameArena arena;
+        DrawList draw_list;
+        RayCaster ray_caster(jobs, assets.renderables, assets.terrain.get());
+        SceneReloader reloader(jobs, settings_filename, settings);
 
-        spdlog::info("loaded object {}", model_filename);
-    }
+        Simulation simulation(jobs, scene, default_camera(), assets.light_pivot, settings.tick_rate);
+        simulation.start();
 
-    auto sun_vert_shader_filename = fmt::format(
-        "{}/shaders/{}",
-        settings.root_folder,
-        settings.sun.vertex_shader);
+        Snapshot snapshot;
+        auto picking = false;
+        auto listing = false;
 
-    spdlog::info("vertex {}", vertex_shader_filename);
+        // once warm, frames reuse what earlier ones allocated, so this warns
+        // when some part of the loop keeps allocating
+        FrameAllocations frame_allocations;
 
-    auto sun_frag_shader_filename = fmt::format(
-        "{}/shaders/{}",
-        settings.root_folder,
-        settings.sun.fragment_shader);
+        while (!glfwWindowShouldClose(window))
+        {
+            frame_allocations.begin_frame();
+            arena.reset();
 
-    auto sun_shader = std::make_shared<ShaderProgram>(
-        sun_vert_shader_filename,
-        sun_frag_shader_filename);
+            glfwPollEvents();
+            simulation.set_input(process_input(window));
 
-    auto sun_model_filename = fmt::format(
-        "{}/res/{}",
-        settings.root_folder,
-        settings.sun.model);
+            // rendering runs one tick behind the simulation, so there are always
+            // two snapshots around the time being drawn
+            auto& snapshots = simulation.snapshots();
+            snapshots.acquire();
 
-    CsvModel sun_model(
-        sun_model_filename,
-        sun_shader,
-        nullptr);
+            auto& from = snapshots.previous();
+            auto& to = snapshots.current();
+            auto render_time = simulation.now() - simulation.tick_interval();
+            auto alpha = 1.0f;
 
-    Camera camera(
-        glm::vec3(0.0f, 0.0f, 3.0f),
-        glm::vec3(0.0f, 0.0f, -1.0f),
-        glm::vec3(0.0f, 1.0f, 0.0f));
+            if (to.time > from.time)
+                alpha = std::min(std::max((float) ((render_time - from.time) / (to.time - from.time)), 0.0f), 1.0f);
 
-    glm::vec3 light_pos(0.0f, -0.5f, 3.0f);
+            {
+                AllocationScope scope(AllocationTag::snapshot);
+                interpolate(jobs, from, to, alpha, snapshot);
+            }
 
-    while (!glfwWindowShouldClose(window))
-    {
-        process_input(window, camera);
+            {
+                AllocationScope scope(AllocationTag::reload);
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                if (reloader.update(simulation, snapshot, assets, backend))
+                    ray_caster.update(jobs, assets.renderables);
+            }
 
-        auto angle = fmodf((float) glfwGetTime(), 3.5f);
-        auto light_rot = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(-0.5f, 0.0f, 0.0f));
+            auto frame = prepare_frame(
+                jobs, snapshot, assets,
+                (float) window_width / (float) window_height, arena, draw_list);
 
-        shader->use();
+            int framebuffer_width, framebuffer_height;
+            glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+            backend.set_framebuffer_size(framebuffer_width, framebuffer_height);
 
-        auto model = glm::mat4(1.0f);
-        auto view = glm::mat4(1.0f);
-        auto projection = glm::mat4(1.0f);
+            {
+                AllocationScope scope(AllocationTag::backend);
+                backend.draw_frame(frame);
+            }
 
-        constexpr bool spin = false;
+            // P picks what the camera looks at, once per press
+            auto pick = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
 
-        if (spin)
-        {
-            model = glm::rotate(model,
-                (float) glfwGetTime(), glm::vec3(0.0f, -0.5f, 0.0f));
+            if (pick && !picking)
+                log_pick(assets, ray_caster, snapshot);
 
-            view = glm::translate(view, glm::vec3(0.0f, -0.7f, -3.0f));
-        }
-        else
-        {
-            view = camera.look_at();
+            picking = pick;
+
+            // T lists what the texture streamer has resident
+            auto list = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+
+            if (list && !listing && streamer)
+                log_textures(*streamer);
+
+            listing = list;
+
+            glfwSwapBuffers(window);
         }
 
-        projection = glm::perspective(glm::radians(45.0f),
-            (float) window_width / (float) window_height, 0.1f, 100.0f);
-
-        auto shader_id = shader->id();
-        auto light_pos_loc = glGetUniformLocation(shader_id, "lightPos");
-        auto light_rot_loc = glGetUniformLocation(shader_id, "lightRot");
-        auto light_color_loc = glGetUniformLocation(shader_id, "lightColor");
-        auto view_pos_loc = glGetUniformLocation(shader_id, "viewPos");
-        glUniform3fv(light_pos_loc, 1, glm::value_ptr(light_pos));
-        glUniformMatrix4fv(light_rot_loc, 1, GL_FALSE, glm::value_ptr(light_rot));
-        glUniform3f(light_color_loc, 1.0f, 1.0f, 0.58f);
-        glUniform3fv(view_pos_loc, 1, glm::value_ptr(camera.pos()));
-
-        for (auto& object: scene)
-            object.render(model, view, projection);
-
-        sun_shader->use();
-        model = light_rot;
-        model = glm::translate(model, light_pos);
-        model = glm::scale(model, glm::vec3(0.2f));
-        sun_model.render_sun(model, view, projection);
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        simulation.stop();
     }
 
+    // the backend owns GL objects, so it goes away before the context
     glfwTerminate();
     return EXIT_SUCCESS;
 }
+
+int main(int argc, char** argv)
+{
+    auto settings = load_settings(settings_filename);
+
+    // --software <output prefix> [frames] renders offline on the CPU
+    if (argc >= 3 && std::strcmp(argv[1], "--software") == 0)
+    {
+        auto frames = argc >= 4 ? std::max(std::atoi(argv[3]), 1) : default_software_frames;
+        return render_software(settings, argv[2], frames);
+    }
+
+    return render_window(settings);
+}
@@ -0,0 +1,398 @@
+#include <mesh-tools.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define MESH_TOOLS_SSE
+#include <xmmintrin.h>
+#endif
+
+constexpr int triangle_floats = 3 * CsvModel::floats_per_vertex;
+constexpr std::size_t normal_batch_size = 4096;
+
+// twice the area below which a triangle counts as degenerate
+constexpr float min_double_area = 1e-12f;
+
+// corner positions of up to four triangles, one lane each
+struct TriangleBatch
+{
+    alignas(16) float x[3][4];
+    alignas(16) float y[3][4];
+    alignas(16) float z[3][4];
+};
+
+static void load_batch(const float* vertices, std::size_t first, std::size_t count, TriangleBatch& batch)
+{
+    for (std::size_t lane = 0; lane < 4; lane++)
+    {
+        // missing lanes repeat the first triangle and are never written back
+        auto triangle = vertices + (first + (lane < count ? lane : 0)) * triangle_floats;
+
+        for (int corner = 0; corner < 3; corner++)
+        {
+            auto position = triangle + corner * CsvModel::floats_per_vertex + CsvModel::position_offset;
+            batch.x[corner][lane] = position[0];
+            batch.y[corner][lane] = position[1];
+            batch.z[corner][lane] = position[2];
+        }
+    }
+}
+
+// cross(p0 - p1, p1 - p2), the winding the csv files were made with.
+// normalized when unit is set, triangles without area get a zero normal
+static void face_normals(const TriangleBatch& batch, bool unit, float nx[4], float ny[4], float nz[4])
+{
+#ifdef MESH_TOOLS_SSE
+    auto x0 = _mm_load_ps(batch.x[0]), y0 = _mm_load_ps(batch.y[0]), z0 = _mm_load_ps(batch.z[0]);
+    auto x1 = _mm_load_ps(batch.x[1]), y1 = _mm_load_ps(batch.y[1]), z1 = _mm_load_ps(batch.z[1]);
+    auto x2 = _mm_load_ps(batch.x[2]), y2 = _mm_load_ps(batch.y[2]), z2 = _mm_load_ps(batch.z[2]);
+
+    auto ax = _mm_sub_ps(x0, x1), ay = _mm_sub_ps(y0, y1), az = _mm_sub_ps(z0, z1);
+    auto bx = _mm_sub_ps(x1, x2), by = _mm_sub_ps(y1, y2), bz = _mm_sub_ps(z1, z2);
+
+    auto cx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+    auto cy = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+    auto cz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+
+    if (unit)
+    {
+        auto length_squared = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)),
+            _mm_mul_ps(cz, cz));
+
+        auto has_area = _mm_cmpgt_ps(length_squared, _mm_set1_ps(min_double_area * min_double_area));
+        auto inv_length = _mm_and_ps(has_area,
+            _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(length_squared)));
+
+        cx = _mm_mul_ps(cx, inv_length);
+        cy = _mm_mul_ps(cy, inv_length);
+        cz = _mm_mul_ps(cz, inv_length);
+    }
+
+    _mm_storeu_ps(nx, cx);
+    _mm_storeu_ps(ny, cy);
+    _mm_storeu_ps(nz, cz);
+#else
+    for (int lane = 0; lane < 4; lane++)
+    {
+        glm::vec3 p0(batch.x[0][lane], batch.y[0][lane], batch.z[0][lane]);
+        glm::vec3 p1(batch.x[1][lane], batch.y[1][lane], batch.z[1][lane]);
+        glm::vec3 p2(batch.x[2][lane], batch.y[2][lane], batch.z[2][lane]);
+
+        auto normal = glm::cross(p0 - p1, p1 - p2);
+        auto length = glm::length(normal);
+
+        if (unit)
+            normal = length > min_double_area ? normal / length : glm::vec3(0.0f);
+
+        nx[lane] = normal.x;
+        ny[lane] = normal.y;
+        nz[lane] = normal.z;
+    }
+#endif // MESH_TOOLS_SSE
+}
+
+// cosine of the angle of every triangle at each of its corners
+static void corner_cosines(const TriangleBatch& batch, float cosines[3][4])
+{
+#ifdef MESH_TOOLS_SSE
+    __m128 x[3], y[3], z[3];
+
+    for (int corner = 0; corner < 3; corner++)
+    {
+        x[corner] = _mm_load_ps(batch.x[corner]);
+        y[corner] = _mm_load_ps(batch.y[corner]);
+        z[corner] = _mm_load_ps(batch.z[corner]);
+    }
+
+    // unit edge from corner a to corner b
+    auto edge = [&](int a, int b, __m128& ex, __m128& ey, __m128& ez) {
+        ex = _mm_sub_ps(x[b], x[a]);
+        ey = _mm_sub_ps(y[b], y[a]);
+        ez = _mm_sub_ps(z[b], z[a]);
+
+        auto length_squared = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)),
+            _mm_mul_ps(ez, ez));
+
+        auto inv_length = _mm_div_ps(_mm_set1_ps(1.0f),
+            _mm_sqrt_ps(_mm_max_ps(length_squared, _mm_set1_ps(1e-30f))));
+
+        ex = _mm_mul_ps(ex, inv_length);
+        ey = _mm_mul_ps(ey, inv_length);
+        ez = _mm_mul_ps(ez, inv_length);
+    };
+
+    __m128 e01x, e01y, e01z, e02x, e02y, e02z, e12x, e12y, e12z;
+    edge(0, 1, e01x, e01y, e01z);
+    edge(0, 2, e02x, e02y, e02z);
+    edge(1, 2, e12x, e12y, e12z);
+
+    auto dot = [](__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+    };
+
+    auto zero = _mm_setzero_ps();
+
+    _mm_storeu_ps(cosines[0], dot(e01x, e01y, e01z, e02x, e02y, e02z));
+    _mm_storeu_ps(cosines[1], dot(_mm_sub_ps(zero, e01x), _mm_sub_ps(zero, e01y), _mm_sub_ps(zero, e01z), e12x, e12y, e12z));
+    _mm_storeu_ps(cosines[2], dot(e02x, e02y, e02z, e12x, e12y, e12z));
+#else
+    for (int lane = 0; lane < 4; lane++)
+    {
+        glm::vec3 p[3];
+
+        for (int corner = 0; corner < 3; corner++)
+            p[corner] = glm::vec3(batch.x[corner][lane], batch.y[corner][lane], batch.z[corner][lane]);
+
+        auto unit = [](glm::vec3 v) {
+            auto length = glm::length(v);
+            return length > 0.0f ? v / length : v;
+        };
+
+        auto e01 = unit(p[1] - p[0]);
+        auto e02 = unit(p[2] - p[0]);
+        auto e12 = unit(p[2] - p[1]);
+
+        cosines[0][lane] = glm::dot(e01, e02);
+        cosines[1][lane] = glm::dot(-e01, e12);
+        cosines[2][lane] = glm::dot(e02, e12);
+    }
+#endif // MESH_TOOLS_SSE
+}
+
+static std::size_t triangle_count(const CsvMesh& mesh)
+{
+    return mesh.vertices.size() / triangle_floats;
+}
+
+MeshReport validate_mesh(const CsvMesh& mesh)
+{
+    MeshReport report;
+    report.triangles = triangle_count(mesh);
+
+    for (auto value: mesh.vertices)
+        report.invalid_values += !std::isfinite(value);
+
+    TriangleBatch batch;
+    alignas(16) float nx[4], ny[4], nz[4];
+
+    for (std::size_t first = 0; first < report.triangles; first += 4)
+    {
+        auto count = std::min<std::size_t>(4, report.triangles - first);
+        load_batch(mesh.vertices.data(), first, count, batch);
+        face_normals(batch, false, nx, ny, nz);
+
+        for (std::size_t lane = 0; lane < count; lane++)
+        {
+            auto length_squared = nx[lane] * nx[lane] + ny[lane] * ny[lane] + nz[lane] * nz[lane];
+
+            // NaN compares false, so triangles with invalid values count too
+            if (!(length_squared > min_double_area * min_double_area))
+                report.degenerate_triangles++;
+        }
+    }
+
+    return report;
+}
+
+std::size_t remove_degenerate_triangles(CsvMesh& mesh)
+{
+    auto triangles = triangle_count(mesh);
+    auto vertices = mesh.vertices.data();
+
+    TriangleBatch batch;
+    alignas(16) float nx[4], ny[4], nz[4];
+    std::size_t kept = 0;
+
+    for (std::size_t first = 0; first < triangles; first += 4)
+    {
+        auto count = std::min<std::size_t>(4, triangles - first);
+        load_batch(vertices, first, count, batch);
+        face_normals(batch, false, nx, ny, nz);
+
+        for (std::size_t lane = 0; lane < count; lane++)
+        {
+            auto length_squared = nx[lane] * nx[lane] + ny[lane] * ny[lane] + nz[lane] * nz[lane];
+
+            if (!(length_squared > min_double_area * min_double_area))
+                continue;
+
+            // kept never passes the triangle being read, so compacting in
+            // place is safe
+            if (kept != first + lane)
+            {
+                std::memmove(
+                    vertices + kept * triangle_floats,
+                    vertices + (first + lane) * triangle_floats,
+                    triangle_floats * sizeof(float));
+            }
+
+            kept++;
+        }
+    }
+
+    mesh.vertices.resize(kept * triangle_floats);
+    return triangles - kept;
+}
+
+void generate_flat_normals(JobSystem& jobs, CsvMesh& mesh)
+{
+    auto triangles = triangle_count(mesh);
+    auto vertices = mesh.vertices.data();
+
+    jobs.parallel_for(triangles, normal_batch_size, [&](std::size_t begin, std::size_t end) {
+        TriangleBatch batch;
+        alignas(16) float nx[4], ny[4], nz[4];
+
+        for (auto first = begin; first < end; first += 4)
+        {
+            auto count = std::min<std::size_t>(4, end - first);
+            load_batch(vertices, first, count, batch);
+            face_normals(batch, true, nx, ny, nz);
+
+            for (std::size_t lane = 0; lane < count; lane++)
+            {
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    auto normal = vertices + (first + lane) * triangle_floats
+                        + corner * CsvModel::floats_per_vertex + CsvModel::normal_offset;
+
+                    normal[0] = nx[lane];
+                    normal[1] = ny[lane];
+                    normal[2] = nz[lane];
+                }
+            }
+        }
+    });
+
+    mesh.has_normals = true;
+}
+
+namespace
+{
+    struct PositionKey
+    {
+        std::uint32_t bits[3];
+
+        bool operator == (const PositionKey& other) const
+        {
+            return bits[0] == other.bits[0]
+                && bits[1] == other.bits[1]
+                && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionHash
+    {
+        std::size_t operator () (const PositionKey& key) const
+        {
+            std::uint64_t h = key.bits[0];
+            h = h * 0x9e3779b97f4a7c15ull ^ key.bits[1];
+            h = h * 0x9e3779b97f4a7c15ull ^ key.bits[2];
+            return static_cast<std::size_t>(h ^ (h >> 32));
+        }
+    };
+}
+
+void generate_smooth_normals(JobSystem& jobs, CsvMesh& mesh)
+{
+    auto triangles = triangle_count(mesh);
+    auto vertex_count = triangles * 3;
+    auto vertices = mesh.vertices.data();
+
+    // vertices at the same position share one accumulated normal
+    std::vector<std::uint32_t> position_ids(vertex_count);
+    std::unordered_map<PositionKey, std::uint32_t, PositionHash> ids;
+    ids.reserve(vertex_count);
+
+    for (std::size_t i = 0; i < vertex_count; i++)
+    {
+        auto position = vertices + i * CsvModel::floats_per_vertex + CsvModel::position_offset;
+
+        PositionKey key;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            // +0 and -0 are the same position
+            auto value = position[axis] == 0.0f ? 0.0f : position[axis];
+            std::memcpy(&key.bits[axis], &value, sizeof(float));
+        }
+
+        auto inserted = ids.emplace(key, static_cast<std::uint32_t>(ids.size()));
+        position_ids[i] = inserted.first->second;
+    }
+
+    // every corner weighs its triangle normal by its angle
+    std::vector<glm::vec3> weighted(vertex_count);
+
+    jobs.parallel_for(triangles, normal_batch_size, [&](std::size_t begin, std::size_t end) {
+        TriangleBatch batch;
+        alignas(16) float nx[4], ny[4], nz[4];
+        alignas(16) float cosines[3][4];
+
+        for (auto first = begin; first < end; first += 4)
+        {
+            auto count = std::min<std::size_t>(4, end - first);
+            load_batch(vertices, first, count, batch);
+            face_normals(batch, true, nx, ny, nz);
+            corner_cosines(batch, cosines);
+
+            for (std::size_t lane = 0; lane < count; lane++)
+            {
+                glm::vec3 normal(nx[lane], ny[lane], nz[lane]);
+
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    auto cosine = std::min(std::max(cosines[corner][lane], -1.0f), 1.0f);
+                    weighted[(first + lane) * 3 + corner] = normal * std::acos(cosine);
+                }
+            }
+        }
+    });
+
+    std::vector<glm::vec3> sums(ids.size(), glm::vec3(0.0f));
+
+    for (std::size_t i = 0; i < vertex_count; i++)
+        sums[position_ids[i]] += weighted[i];
+
+    jobs.parallel_for(vertex_count, normal_batch_size, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++)
+        {
+            auto sum = sums[position_ids[i]];
+            auto length = glm::length(sum);
+            auto normal = length > 0.0f ? sum / length : glm::vec3(0.0f);
+
+            auto out = vertices + i * CsvModel::floats_per_vertex + CsvModel::normal_offset;
+            out[0] = normal.x;
+            out[1] = normal.y;
+            out[2] = normal.z;
+        }
+    });
+
+    mesh.has_normals = true;
+}
+
+void generate_normals(JobSystem& jobs, CsvMesh& mesh, NormalMode mode)
+{
+    switch (mode)
+    {
+    case NormalMode::keep:
+        if (!mesh.has_normals)
+            generate_flat_normals(jobs, mesh);
+        break;
+
+    case NormalMode::flat:
+        generate_flat_normals(jobs, mesh);
+        break;
+
+    case NormalMode::smooth:
+        generate_smooth_normals(jobs, mesh);
+        break;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+#include <csv-model.hpp>
+#include <job-system.hpp>
+
+// offline processing of csv meshes, used by the cook tool so the game never
+// has to do it while loading
+
+enum class NormalMode
+{
+    keep, // keeps the normals of the file, flat ones when it has none
+    flat,
+    smooth
+};
+
+struct MeshReport
+{
+    std::size_t triangles = 0;
+    std::size_t degenerate_triangles = 0;
+    std::size_t invalid_values = 0; // NaN or infinite floats
+};
+
+MeshReport validate_mesh(const CsvMesh& mesh);
+
+// drops the triangles without area and returns how many there were
+std::size_t remove_degenerate_triangles(CsvMesh& mesh);
+
+// the normal of each triangle on its three vertices
+void generate_flat_normals(JobSystem& jobs, CsvMesh& mesh);
+
+// vertices sharing a position get the average of the normals of the
+// triangles around them, weighted by the angle of each triangle at it
+void generate_smooth_normals(JobSystem& jobs, CsvMesh& mesh);
+
+void generate_normals(JobSystem& jobs, CsvMesh& mesh, NormalMode mode);
@@ -0,0 +1,290 @@
+#include <ray-caster.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+// the terrain is a heightfield without a BVH, rays march over it in steps of
+// this many units and then bisect the step that went below the ground
+constexpr float terrain_step = 0.25f;
+constexpr int terrain_refinements = 8;
+
+// furthest the terrain is marched, the far plane of the camera
+constexpr float terrain_range = 100.0f;
+
+// keeps visibility rays off the surfaces they start and end on
+constexpr float visibility_epsilon = 1e-3f;
+
+constexpr float infinity = std::numeric_limits<float>::infinity();
+
+// slab test of the ray against a world space box, within [0, max_distance]
+static bool intersects(const Ray& ray, const Bounds& bounds)
+{
+    auto near = 0.0f;
+    auto far = ray.max_distance;
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (ray.direction[i] == 0.0f)
+        {
+            if (ray.origin[i] < bounds.min[i] || ray.origin[i] > bounds.max[i])
+                return false;
+
+            continue;
+        }
+
+        auto inverse = 1.0f / ray.direction[i];
+        auto t0 = (bounds.min[i] - ray.origin[i]) * inverse;
+        auto t1 = (bounds.max[i] - ray.origin[i]) * inverse;
+
+        near = std::max(near, std::min(t0, t1));
+        far = std::min(far, std::max(t0, t1));
+    }
+
+    return near <= far;
+}
+
+RayCaster::RayCaster(
+    JobSystem& jobs,
+    const std::vector<Renderable>& renderables,
+    const Terrain* terrain) :
+    _terrain(terrain)
+{
+    update(jobs, renderables);
+}
+
+void RayCaster::update(JobSystem& jobs, const std::vector<Renderable>& renderables)
+{
+    std::unordered_map<const CsvModel*, std::unique_ptr<MeshBvh>> bvhs;
+    std::vector<const CsvModel*> models;
+
+    for (auto& renderable: renderables)
+    {
+        // the sun is a light, it must not block the rays going towards it
+        if (renderable.shading != ShadingModel::phong || renderable.model == nullptr)
+            continue;
+
+        // models shared by several renderables get one BVH
+        if (bvhs.count(renderable.model) != 0)
+            continue;
+
+        auto it = _bvhs.find(renderable.model);
+
+        if (it != _bvhs.end())
+        {
+            bvhs.emplace(renderable.model, std::move(it->second));
+            continue;
+        }
+
+        bvhs.emplace(renderable.model, nullptr);
+        models.push_back(renderable.model);
+    }
+
+    // the workers only write the values, the map itself does not change
+    jobs.parallel_for(models.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++)
+            bvhs.find(models[i])->second = std::make_unique<MeshBvh>(*models[i]);
+    });
+
+    _renderables = renderables;
+    _bvhs = std::move(bvhs);
+    _bvh_of.assign(renderables.size(), nullptr);
+
+    for (std::size_t i = 0; i < renderables.size(); i++)
+    {
+        auto it = _bvhs.find(renderables[i].model);
+
+        if (it != _bvhs.end() && renderables[i].shading == ShadingModel::phong)
+            _bvh_of[i] = it->second.get();
+    }
+}
+
+// calls query(index, bvh, local_ray) for every object whose world bounds the
+// ray touches, stopping when it returns true
+template <typename Query>
+bool RayCaster::for_each_object(
+    const Ray& ray,
+    const std::vector<glm::mat4>& world,
+    const std::vector<Bounds>& world_bounds,
+    Query&& query) const
+{
+    for (std::size_t i = 0; i < _renderables.size(); i++)
+    {
+        if (_bvh_of[i] == nullptr)
+            continue;
+
+        auto entity = _renderables[i].entity;
+
+        if (entity != no_entity && !intersects(ray, world_bounds[entity]))
+            continue;
+
+        Ray local = ray;
+
+        if (entity != no_entity)
+        {
+            // the direction is not normalized again, so distances along the
+            // local ray are the same as along the world one
+            auto inverse = glm::inverse(world[entity]);
+            local.origin = glm::vec3(inverse * glm::vec4(ray.origin, 1.0f));
+            local.direction = glm::vec3(inverse * glm::vec4(ray.direction, 0.0f));
+        }
+
+        if (query(i, *_bvh_of[i], local))
+            return true;
+    }
+
+    return false;
+}
+
+bool RayCaster::cast_terrain(const Ray& ray, float& distance) const
+{
+    if (_terrain == nullptr)
+        return false;
+
+    auto below = [&](float t) {
+        auto point = ray.origin + ray.direction * t;
+        return point.y <= _terrain->height(point.x, point.z);
+    };
+
+    // rays starting underground do not see the terrain
+    if (below(0.0f))
+        return false;
+
+    auto length = glm::length(ray.direction);
+
+    if (length == 0.0f)
+        return false;
+
+    auto step = terrain_step / length;
+    auto end = std::min(ray.max_distance, terrain_range / length);
+
+    for (auto t = step; t - step < end; t += step)
+    {
+        auto far = std::min(t, end);
+
+        if (!below(far))
+            continue;
+
+        auto near = t - step;
+
+        for (int i = 0; i < terrain_refinements; i++)
+        {
+            auto middle = (near + far) * 0.5f;
+
+            if (below(middle))
+                far = middle;
+            else
+                near = middle;
+        }
+
+        distance = far;
+        return true;
+    }
+
+    return false;
+}
+
+WorldHit RayCaster::cast(
+    const Ray& ray,
+    const std::vector<glm::mat4>& world,
+    const std::vector<Bounds>& world_bounds) const
+{
+    WorldHit result;
+    Ray closest = ray;
+
+    for_each_object(closest, world, world_bounds, [&](std::size_t index, const MeshBvh& bvh, const Ray& local) {
+        RayHit hit;
+
+        if (bvh.intersect(local, hit))
+        {
+            result.distance = hit.distance;
+            result.renderable = index;
+            result.hit = true;
+
+            // later objects only need to beat this one
+            closest.max_distance = hit.distance;
+        }
+
+        return false;
+    });
+
+    auto distance = 0.0f;
+
+    if (cast_terrain(closest, distance))
+    {
+        result.distance = distance;
+        result.renderable = WorldHit::no_renderable;
+        result.hit = true;
+    }
+
+    if (result.hit)
+        result.position = ray.origin + ray.direction * result.distance;
+
+    return result;
+}
+
+bool RayCaster::visible(
+    const glm::vec3& from,
+    const glm::vec3& to,
+    const std::vector<glm::mat4>& world,
+    const std::vector<Bounds>& world_bounds) const
+{
+    Ray ray;
+    ray.origin = from;
+    ray.direction = to - from;
+
+    auto length = glm::length(ray.direction);
+
+    if (length <= 2.0f * visibility_epsilon)
+        return true;
+
+    // the segment in units of the direction, minus a little at both ends
+    auto epsilon = visibility_epsilon / length;
+    ray.origin += ray.direction * epsilon;
+    ray.max_distance = 1.0f - 2.0f * epsilon;
+
+    auto blocked = for_each_object(ray, world, world_bounds, [](std::size_t, const MeshBvh& bvh, const Ray& local) {
+        return bvh.occluded(local);
+    });
+
+    auto distance = 0.0f;
+    return !blocked && !cast_terrain(ray, distance);
+}
+
+float RayCaster::ground_height(
+    const glm::vec3& position,
+    const std::vector<glm::mat4>& world,
+    const std::vector<Bounds>& world_bounds) const
+{
+    auto height = -infinity;
+
+    if (_terrain != nullptr)
+    {
+        auto ground = _terrain->height(position.x, position.z);
+
+        if (ground <= position.y)
+            height = ground;
+    }
+
+    Ray ray;
+    ray.origin = position;
+    ray.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+
+    if (height > -infinity)
+        ray.max_distance = position.y - height;
+
+    for_each_object(ray, world, world_bounds, [&](std::size_t, const MeshBvh& bvh, const Ray& local) {
+        RayHit hit;
+
+        if (bvh.intersect(local, hit))
+        {
+            height = position.y - hit.distance;
+            ray.max_distance = hit.distance;
+        }
+
+        return false;
+    });
+
+    return height;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <bvh.hpp>
+#include <csv-model.hpp>
+#include <draw-list.hpp>
+#include <job-system.hpp>
+#include <terrain.hpp>
+#include <transform.hpp>
+
+struct WorldHit
+{
+    static constexpr std::size_t no_renderable = ~std::size_t(0);
+
+    float distance = std::numeric_limits<float>::infinity();
+
+    // index into the renderables the caster was made with, no_renderable
+    // when the ray hit the terrain or nothing
+    std::size_t renderable = no_renderable;
+    glm::vec3 position = glm::vec3(0.0f);
+    bool hit = false;
+};
+
+// picking, ground height and line of sight queries against the phong
+// renderables and the terrain. every model gets a BVH once and rays are moved
+// into its space by the inverse world matrix, so distances stay in units of
+// the world space direction
+class RayCaster
+{
+public:
+    // builds the BVHs of the models on the workers. terrain may be null
+    RayCaster(
+        JobSystem& jobs,
+        const std::vector<Renderable>& renderables,
+        const Terrain* terrain);
+
+    // for a new list of renderables. keeps the BVHs of the models it already
+    // has, builds the new ones and drops the ones nothing uses anymore. BVHs
+    // are found by model address, so it must run every time the renderables
+    // change, before any new model is created
+    void update(JobSystem& jobs, const std::vector<Renderable>& renderables);
+
+    // world and world_bounds are indexed by entity, as in the draw list
+    WorldHit cast(
+        const Ray& ray,
+        const std::vector<glm::mat4>& world,
+        const std::vector<Bounds>& world_bounds) const;
+
+    // true when nothing solid lies between the two points
+    bool visible(
+        const glm::vec3& from,
+        const glm::vec3& to,
+        const std::vector<glm::mat4>& world,
+        const std::vector<Bounds>& world_bounds) const;
+
+    // height of the highest surface below position, -infinity over nothing
+    float ground_height(
+        const glm::vec3& position,
+        const std::vector<glm::mat4>& world,
+        const std::vector<Bounds>& world_bounds) const;
+
+private:
+    template <typename Query>
+    bool for_each_object(
+        const Ray& ray,
+        const std::vector<glm::mat4>& world,
+        const std::vector<Bounds>& world_bounds,
+        Query&& query) const;
+
+    bool cast_terrain(const Ray& ray, float& distance) const;
+
+    std::vector<Renderable> _renderables;
+    std::unordered_map<const CsvModel*, std::unique_ptr<MeshBvh>> _bvhs;
+
+    // BVH of every renderable, null for the ones rays ignore
+    std::vector<const MeshBvh*> _bvh_of;
+
+    const Terrain* _terrain;
+};
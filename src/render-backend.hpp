@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <csv-model.hpp>
+#include <draw-list.hpp>
+#include <texture.hpp>
+
+// everything a backend needs to draw one frame
+struct FrameData
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 view_pos = glm::vec3(0.0f);
+
+    glm::vec3 light_pos = glm::vec3(0.0f);
+    glm::mat4 light_rot = glm::mat4(1.0f);
+    glm::vec3 light_color = glm::vec3(1.0f);
+
+    // in the frame arena of the frame
+    const DrawCommand* commands = nullptr;
+    std::size_t command_count = 0;
+};
+
+// draws frames out of the CPU side models and textures, creating whatever
+// resources it needs from them on first use
+class RenderBackend
+{
+public:
+    virtual ~RenderBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual void draw_frame(const FrameData& frame) = 0;
+
+    // drop whatever was created for a model or texture. called before they
+    // are destroyed, so a new one at the same address is not mistaken for
+    // the old one
+    virtual void release(const CsvModel& model)
+    {
+    }
+
+    virtual void release(const Texture& texture)
+    {
+    }
+};
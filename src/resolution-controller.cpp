@@ -0,0 +1,58 @@
+#include <resolution-controller.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <spdlog/spdlog.h>
+
+ResolutionController::ResolutionController(const DynamicResolutionSettings& settings) :
+    _settings(settings),
+    _scale(settings.max_scale)
+{
+}
+
+bool ResolutionController::add_sample(double milliseconds)
+{
+    _total_ms += milliseconds;
+    _samples++;
+
+    if (_samples < _settings.adjust_frames)
+        return false;
+
+    auto average = _total_ms / _samples;
+    auto samples = _samples;
+
+    _total_ms = 0.0;
+    _samples = 0;
+
+    auto target = (double) _settings.target_ms;
+
+    if (average <= target && average >= target * (1.0 - dead_band))
+        return false;
+
+    auto desired = _scale * (float) std::sqrt(target / average);
+
+    // growing goes half way at a time, a cheaper frame may only mean the
+    // camera looks at less of the scene for a moment. shrinking rounds down,
+    // so the new scale lands under the target
+    if (desired > _scale)
+    {
+        desired = _scale + (desired - _scale) * 0.5f;
+        desired = std::round(desired / scale_step) * scale_step;
+    }
+    else
+    {
+        desired = std::floor(desired / scale_step) * scale_step;
+    }
+
+    desired = std::min(std::max(desired, _settings.min_scale), _settings.max_scale);
+
+    if (desired == _scale)
+        return false;
+
+    spdlog::info("render scale {:.3f} -> {:.3f}: {:.2f} ms on the GPU over {} frames, target {:.2f} ms",
+        _scale, desired, average, samples, target);
+
+    _scale = desired;
+    return true;
+}
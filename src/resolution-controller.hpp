@@ -0,0 +1,39 @@
+#pragma once
+
+#include <settings.hpp>
+
+// picks the render scale from the GPU time of the last frames. the cost of a
+// frame is mostly fragments, which grow with the square of the scale, so the
+// scale moves by the square root of how far the time is from the target
+class ResolutionController
+{
+public:
+    explicit ResolutionController(const DynamicResolutionSettings& settings);
+
+    // adds the GPU time of one frame, true when it changed the scale
+    bool add_sample(double milliseconds);
+
+    float scale() const
+    {
+        return _scale;
+    }
+
+    const DynamicResolutionSettings& settings() const
+    {
+        return _settings;
+    }
+
+private:
+    // frames faster than the target by less than this fraction keep their
+    // scale, so it does not flip back and forth around the target
+    static constexpr double dead_band = 0.15;
+
+    // scales are rounded to steps of this size
+    static constexpr float scale_step = 1.0f / 32.0f;
+
+    DynamicResolutionSettings _settings;
+    float _scale;
+
+    double _total_ms = 0.0;
+    int _samples = 0;
+};
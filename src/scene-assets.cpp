@@ -0,0 +1,430 @@
+#include <scene-assets.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include <glm/gtc/quaternion.hpp>
+#include <spdlog/spdlog.h>
+
+#include <cooked-assets.hpp>
+
+// reads the files named by the keys into the values, each on a worker
+static void load_files(
+    JobSystem& jobs, const Settings& settings,
+    std::unordered_map<std::string, CsvMesh>& meshes,
+    std::unordered_map<std::string, std::shared_ptr<Texture>>& images)
+{
+    std::vector<std::pair<const std::string, CsvMesh>*> mesh_entries;
+    std::vector<std::pair<const std::string, std::shared_ptr<Texture>>*> image_entries;
+
+    for (auto& entry: meshes)
+        mesh_entries.push_back(&entry);
+
+    for (auto& entry: images)
+        image_entries.push_back(&entry);
+
+    jobs.parallel_for(mesh_entries.size() + image_entries.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++)
+        {
+            if (i < mesh_entries.size())
+            {
+                auto& entry = *mesh_entries[i];
+                entry.second = load_mesh_asset(jobs, settings, entry.first);
+            }
+            else
+            {
+                auto& entry = *image_entries[i - mesh_entries.size()];
+                entry.second = load_texture_asset(settings, entry.first);
+            }
+        }
+    });
+}
+
+static void place_object(Scene& scene, Entity entity, const ObjectSettings& object, const Bounds& bounds)
+{
+    scene.set_position(entity, object.position);
+    scene.set_rotation(entity, glm::quat(glm::radians(object.rotation)));
+    scene.set_scale(entity, object.scale);
+    scene.set_local_bounds(entity, bounds);
+}
+
+static bool same_transform(const ObjectSettings& a, const ObjectSettings& b)
+{
+    return a.position == b.position && a.rotation == b.rotation && a.scale == b.scale;
+}
+
+// the texture of the file, moved into the cache from images when no object
+// uses it yet
+static std::shared_ptr<Texture> texture_for(
+    SceneAssets& assets, const std::string& name,
+    std::unordered_map<std::string, std::shared_ptr<Texture>>& images)
+{
+    auto& texture = assets.textures[name];
+
+    if (!texture)
+        texture = std::move(images.at(name));
+
+    return texture;
+}
+
+void load_scene(JobSystem& jobs, const Settings& settings, Scene& scene, SceneAssets& assets)
+{
+    std::unordered_map<std::string, CsvMesh> meshes;
+    std::unordered_map<std::string, std::shared_ptr<Texture>> images;
+
+    meshes[settings.sun.model];
+
+    for (auto& object: settings.objects)
+    {
+        meshes[object.model];
+        images[object.texture];
+    }
+
+    load_files(jobs, settings, meshes, images);
+
+    for (auto& object: settings.objects)
+    {
+        auto texture = texture_for(assets, object.texture, images);
+        auto model = std::make_unique<CsvModel>(meshes.at(object.model), texture);
+
+        auto entity = scene.create_entity();
+        place_object(scene, entity, object, model->bounds());
+
+        assets.objects.push_back(SceneObject { object, entity, std::move(model) });
+
+        spdlog::info("loaded object {}", object.model);
+    }
+
+    assets.sun_model = std::make_unique<CsvModel>(std::move(meshes.at(settings.sun.model)), nullptr);
+
+    // the sun orbits around a pivot, so only the pivot rotation is animated
+    assets.light_pivot = scene.create_entity();
+    assets.sun = scene.create_entity(assets.light_pivot, assets.sun_model->bounds());
+    scene.set_position(assets.sun, light_pos);
+    scene.set_scale(assets.sun, glm::vec3(0.2f));
+
+    if (settings.terrain.enabled)
+    {
+        auto& terrain = settings.terrain;
+
+        auto texture = std::make_shared<Texture>(
+            load_image_asset(settings, terrain.texture));
+
+        Image heightmap;
+
+        if (!terrain.heightmap.empty())
+            heightmap = load_image_asset(settings, terrain.heightmap);
+
+        assets.terrain = std::make_unique<Terrain>(
+            jobs, terrain, std::move(texture), std::move(heightmap));
+    }
+
+    collect_renderables(assets);
+}
+
+void collect_renderables(SceneAssets& assets)
+{
+    assets.renderables.clear();
+
+    for (auto& object: assets.objects)
+    {
+        assets.renderables.push_back(Renderable {
+            object.entity, object.model.get(), ShadingModel::phong });
+    }
+
+    assets.renderables.push_back(Renderable {
+        assets.sun, assets.sun_model.get(), ShadingModel::sun });
+}
+
+SceneReloader::SceneReloader(JobSystem& jobs, const std::string& filename, const Settings& settings) :
+    _jobs(jobs),
+    _filename(filename),
+    _settings(settings),
+    _watcher(filename)
+{
+}
+
+SceneReloader::~SceneReloader()
+{
+    if (_reload && !_reload->planned)
+        _jobs.wait(_reload->counter);
+}
+
+bool SceneReloader::update(
+    Simulation& simulation, const Snapshot& snapshot,
+    SceneAssets& assets, RenderBackend& backend)
+{
+    if (_watcher.changed())
+        _pending = true;
+
+    if (!_reload)
+    {
+        if (_pending)
+        {
+            _pending = false;
+            start(assets);
+        }
+
+        return false;
+    }
+
+    if (!_reload->planned)
+    {
+        if (!_reload->counter.done())
+            return false;
+
+        plan(simulation, assets);
+
+        if (!_reload)
+            return false;
+    }
+
+    // the new objects are only drawn once the snapshot has their entities
+    // in place
+    if (snapshot.edits < _reload->edits)
+        return false;
+
+    finish(assets, backend);
+    return true;
+}
+
+void SceneReloader::start(const SceneAssets& assets)
+{
+    _reload = std::make_unique<Reload>();
+    _reload->reloader = this;
+    _reload->start = std::chrono::steady_clock::now();
+
+    for (auto& object: assets.objects)
+        _reload->live_meshes.insert(object.settings.model);
+
+    for (auto& entry: assets.textures)
+        _reload->live_images.insert(entry.first);
+
+    Job job;
+    job.function = &SceneReloader::run_load;
+    job.data = _reload.get();
+    _jobs.run(job, _reload->counter);
+}
+
+void SceneReloader::run_load(void* data, std::size_t begin, std::size_t end)
+{
+    auto reload = static_cast<Reload*>(data);
+    reload->reloader->load(*reload);
+}
+
+// runs on a worker, only reads the files the live objects do not have
+void SceneReloader::load(Reload& reload) const
+{
+    try
+    {
+        reload.settings = load_settings(_filename);
+
+        for (auto& object: reload.settings.objects)
+        {
+            if (reload.live_meshes.count(object.model) == 0)
+                reload.meshes[object.model];
+
+            if (reload.live_images.count(object.texture) == 0)
+                reload.images[object.texture];
+        }
+
+        load_files(_jobs, reload.settings, reload.meshes, reload.images);
+    }
+    catch (const std::exception& error)
+    {
+        spdlog::error("could not reload \"{}\": {}", _filename, error.what());
+        reload.failed = true;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - reload.start;
+    reload.load_seconds = elapsed.count();
+}
+
+// matches the new objects against the live ones and hands the scene side of
+// the difference to the simulation
+void SceneReloader::plan(Simulation& simulation, SceneAssets& assets)
+{
+    auto& reload = *_reload;
+    reload.planned = true;
+
+    if (reload.failed)
+    {
+        spdlog::warn("keeping the current scene");
+        _reload.reset();
+        return;
+    }
+
+    // only the objects are reloaded, everything else is read once at start
+    auto old_json = nlohmann::json(_settings);
+    auto new_json = nlohmann::json(reload.settings);
+    old_json.erase("objects");
+    new_json.erase("objects");
+
+    for (auto& item: old_json.items())
+    {
+        if (!new_json.contains(item.key()) || new_json[item.key()] != item.value())
+            spdlog::warn("\"{}\" changed, restart to apply it", item.key());
+    }
+
+    for (auto& item: new_json.items())
+    {
+        if (!old_json.contains(item.key()))
+            spdlog::warn("\"{}\" changed, restart to apply it", item.key());
+    }
+
+    // meshes the new objects can copy instead of reading the file again
+    std::unordered_map<std::string, const CsvModel*> live_models;
+
+    for (auto& object: assets.objects)
+        live_models.emplace(object.settings.model, object.model.get());
+
+    struct Placement
+    {
+        Entity entity;
+        ObjectSettings object;
+        Bounds bounds;
+    };
+
+    std::vector<Placement> placements;
+    std::vector<Placement> creations;
+    std::vector<bool> kept(assets.objects.size(), false);
+
+    auto free_entities = assets.free_entities.size();
+
+    for (auto& object: reload.settings.objects)
+    {
+        PlannedObject planned;
+        planned.settings = object;
+
+        // the first live object with the same files is kept
+        for (std::size_t i = 0; i < assets.objects.size(); i++)
+        {
+            auto& live = assets.objects[i];
+
+            if (kept[i] || live.settings.model != object.model || live.settings.texture != object.texture)
+                continue;
+
+            kept[i] = true;
+            planned.kept = static_cast<int>(i);
+            planned.entity = live.entity;
+
+            if (!same_transform(live.settings, object))
+                placements.push_back(Placement { live.entity, object, live.model->bounds() });
+
+            break;
+        }
+
+        if (planned.kept < 0)
+        {
+            auto texture = texture_for(assets, object.texture, reload.images);
+            auto live_model = live_models.find(object.model);
+
+            if (live_model != live_models.end())
+                planned.model = std::make_unique<CsvModel>(live_model->second->mesh(), texture);
+            else
+                planned.model = std::make_unique<CsvModel>(reload.meshes.at(object.model), texture);
+
+            live_models.emplace(object.model, planned.model.get());
+
+            if (free_entities > 0)
+            {
+                planned.entity = assets.free_entities[--free_entities];
+                placements.push_back(Placement { planned.entity, object, planned.model->bounds() });
+            }
+            else
+            {
+                reload.created_for.push_back(reload.objects.size());
+                creations.push_back(Placement { no_entity, object, planned.model->bounds() });
+            }
+        }
+
+        reload.objects.push_back(std::move(planned));
+    }
+
+    assets.free_entities.resize(free_entities);
+
+    if (placements.empty() && creations.empty())
+        return;
+
+    reload.created = std::make_shared<std::vector<Entity>>();
+
+    reload.edits = simulation.edit([placements, creations, created = reload.created](Scene& scene) {
+        for (auto& placement: placements)
+            place_object(scene, placement.entity, placement.object, placement.bounds);
+
+        for (auto& creation: creations)
+        {
+            auto entity = scene.create_entity();
+            place_object(scene, entity, creation.object, creation.bounds);
+            created->push_back(entity);
+        }
+    });
+}
+
+// swaps the new objects in and releases the ones that are gone
+void SceneReloader::finish(SceneAssets& assets, RenderBackend& backend)
+{
+    auto& reload = *_reload;
+
+    for (std::size_t i = 0; i < reload.created_for.size(); i++)
+        reload.objects[reload.created_for[i]].entity = (*reload.created)[i];
+
+    std::vector<SceneObject> objects;
+    std::vector<bool> kept(assets.objects.size(), false);
+    std::size_t added = 0;
+
+    for (auto& planned: reload.objects)
+    {
+        if (planned.kept >= 0)
+        {
+            kept[planned.kept] = true;
+            objects.push_back(SceneObject {
+                planned.settings, planned.entity, std::move(assets.objects[planned.kept].model) });
+        }
+        else
+        {
+            objects.push_back(SceneObject { planned.settings, planned.entity, std::move(planned.model) });
+            added++;
+        }
+    }
+
+    std::size_t removed = 0;
+
+    for (std::size_t i = 0; i < assets.objects.size(); i++)
+    {
+        if (kept[i])
+            continue;
+
+        backend.release(*assets.objects[i].model);
+        assets.free_entities.push_back(assets.objects[i].entity);
+        removed++;
+    }
+
+    assets.objects = std::move(objects);
+
+    // textures left in the cache alone belonged to removed objects
+    for (auto it = assets.textures.begin(); it != assets.textures.end();)
+    {
+        if (it->second.use_count() > 1)
+        {
+            it++;
+            continue;
+        }
+
+        backend.release(*it->second);
+        it = assets.textures.erase(it);
+    }
+
+    collect_renderables(assets);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - reload.start;
+
+    spdlog::info("reloaded \"{}\" in {:.2f} ms ({:.2f} ms loading): {} kept, {} added, {} removed, "
+        "{} meshes and {} images read",
+        _filename, elapsed.count() * 1000.0, reload.load_seconds * 1000.0,
+        assets.objects.size() - added, added, removed, reload.meshes.size(), reload.images.size());
+
+    _settings = std::move(reload.settings);
+    _reload.reset();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <csv-model.hpp>
+#include <draw-list.hpp>
+#include <file-watcher.hpp>
+#include <job-system.hpp>
+#include <render-backend.hpp>
+#include <scene.hpp>
+#include <settings.hpp>
+#include <simulation.hpp>
+#include <terrain.hpp>
+#include <texture.hpp>
+
+// where the sun orbits, relative to its pivot
+const glm::vec3 light_pos(0.0f, -0.5f, 3.0f);
+
+// an object of settings.json and what it became in the scene
+struct SceneObject
+{
+    ObjectSettings settings;
+    Entity entity = no_entity;
+    std::unique_ptr<CsvModel> model;
+};
+
+struct SceneAssets
+{
+    // in the order of settings.json
+    std::vector<SceneObject> objects;
+
+    // by file name, shared by every object using the same file
+    std::unordered_map<std::string, std::shared_ptr<Texture>> textures;
+
+    std::unique_ptr<CsvModel> sun_model;
+    Entity light_pivot = no_entity;
+    Entity sun = no_entity;
+
+    std::unique_ptr<Terrain> terrain;
+
+    // entities of removed objects, reused by the objects added later
+    std::vector<Entity> free_entities;
+
+    // the objects in order, then the sun
+    std::vector<Renderable> renderables;
+};
+
+// loads every object of the settings and the sun into the scene, reading
+// each cooked asset once on the workers
+void load_scene(JobSystem& jobs, const Settings& settings, Scene& scene, SceneAssets& assets);
+
+// rebuilds assets.renderables out of the objects and the sun
+void collect_renderables(SceneAssets& assets);
+
+// reloads the objects of settings.json when the file changes. objects that
+// keep their model and texture only get their transform updated, new files
+// are read on the workers and removed models and textures are released.
+// the other sections need a restart
+class SceneReloader
+{
+public:
+    SceneReloader(JobSystem& jobs, const std::string& filename, const Settings& settings);
+
+    SceneReloader(const SceneReloader& other) = delete;
+    SceneReloader& operator = (const SceneReloader& other) = delete;
+
+    ~SceneReloader();
+
+    // call once per frame on the render thread, with the snapshot being
+    // drawn. returns true when assets.renderables changed
+    bool update(
+        Simulation& simulation, const Snapshot& snapshot,
+        SceneAssets& assets, RenderBackend& backend);
+
+private:
+    // an object of the new settings, either an old object it keeps or a
+    // new model
+    struct PlannedObject
+    {
+        ObjectSettings settings;
+        int kept = -1;
+        Entity entity = no_entity;
+        std::unique_ptr<CsvModel> model;
+    };
+
+    struct Reload
+    {
+        const SceneReloader* reloader;
+        JobCounter counter;
+        std::chrono::steady_clock::time_point start;
+        double load_seconds = 0.0;
+
+        // files the live objects already have, which are not read again
+        std::unordered_set<std::string> live_meshes;
+        std::unordered_set<std::string> live_images;
+
+        Settings settings;
+        bool failed = false;
+
+        std::unordered_map<std::string, CsvMesh> meshes;
+        std::unordered_map<std::string, std::shared_ptr<Texture>> images;
+
+        std::vector<PlannedObject> objects;
+
+        // entities the simulation creates for new objects when there are
+        // no free ones, in the order of created_for
+        std::shared_ptr<std::vector<Entity>> created;
+        std::vector<std::size_t> created_for;
+
+        bool planned = false;
+        std::uint64_t edits = 0;
+    };
+
+    static void run_load(void* data, std::size_t begin, std::size_t end);
+    void load(Reload& reload) const;
+
+    void start(const SceneAssets& assets);
+    void plan(Simulation& simulation, SceneAssets& assets);
+    void finish(SceneAssets& assets, RenderBackend& backend);
+
+    JobSystem& _jobs;
+    std::string _filename;
+    Settings _settings;
+    FileWatcher _watcher;
+
+    std::unique_ptr<Reload> _reload;
+
+    // the file changed again while a reload was running
+    bool _pending = false;
+};
@@ -0,0 +1,159 @@
+#include <scene.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+Entity Scene::create_entity(Entity parent, Bounds local_bounds)
+{
+    if (parent != no_entity && parent >= size())
+        throw std::invalid_argument("parent entity does not exist");
+
+    auto entity = static_cast<Entity>(size());
+
+    _position_x.push_back(0.0f);
+    _position_y.push_back(0.0f);
+    _position_z.push_back(0.0f);
+
+    _rotation_x.push_back(0.0f);
+    _rotation_y.push_back(0.0f);
+    _rotation_z.push_back(0.0f);
+    _rotation_w.push_back(1.0f);
+
+    _scale_x.push_back(1.0f);
+    _scale_y.push_back(1.0f);
+    _scale_z.push_back(1.0f);
+
+    _parents.push_back(parent);
+    _dirty.push_back(1);
+
+    _local.emplace_back(1.0f);
+    _world.emplace_back(1.0f);
+    _local_bounds.push_back(local_bounds);
+    _world_bounds.push_back(local_bounds);
+
+    std::uint32_t depth = parent == no_entity ? 0 : _depths[parent] + 1;
+    _depths.push_back(depth);
+
+    if (_levels.size() <= depth)
+        _levels.resize(depth + 1);
+
+    _levels[depth].push_back(entity);
+    _any_dirty = true;
+
+    return entity;
+}
+
+void Scene::mark_dirty(Entity entity)
+{
+    _dirty[entity] = 1;
+    _any_dirty = true;
+}
+
+void Scene::set_position(Entity entity, glm::vec3 position)
+{
+    _position_x[entity] = position.x;
+    _position_y[entity] = position.y;
+    _position_z[entity] = position.z;
+    mark_dirty(entity);
+}
+
+void Scene::set_rotation(Entity entity, glm::quat rotation)
+{
+    _rotation_x[entity] = rotation.x;
+    _rotation_y[entity] = rotation.y;
+    _rotation_z[entity] = rotation.z;
+    _rotation_w[entity] = rotation.w;
+    mark_dirty(entity);
+}
+
+void Scene::set_scale(Entity entity, glm::vec3 scale)
+{
+    _scale_x[entity] = scale.x;
+    _scale_y[entity] = scale.y;
+    _scale_z[entity] = scale.z;
+    mark_dirty(entity);
+}
+
+void Scene::set_local_bounds(Entity entity, Bounds bounds)
+{
+    _local_bounds[entity] = bounds;
+    mark_dirty(entity);
+}
+
+glm::vec3 Scene::position(Entity entity) const
+{
+    return glm::vec3(
+        _position_x[entity],
+        _position_y[entity],
+        _position_z[entity]);
+}
+
+glm::quat Scene::rotation(Entity entity) const
+{
+    return glm::quat(
+        _rotation_w[entity],
+        _rotation_x[entity],
+        _rotation_y[entity],
+        _rotation_z[entity]);
+}
+
+glm::vec3 Scene::scale(Entity entity) const
+{
+    return glm::vec3(
+        _scale_x[entity],
+        _scale_y[entity],
+        _scale_z[entity]);
+}
+
+void Scene::update(JobSystem& jobs)
+{
+    if (!_any_dirty)
+        return;
+
+    // local matrices only depend on the entity itself, so they are rebuilt
+    // in contiguous batches regardless of the hierarchy
+    jobs.parallel_for(size(), batch_size, [this](std::size_t begin, std::size_t end) {
+        auto first_dirty = std::find(_dirty.begin() + begin, _dirty.begin() + end, 1);
+
+        if (first_dirty == _dirty.begin() + end)
+            return;
+
+        compose_transforms(
+            end - begin,
+            &_position_x[begin], &_position_y[begin], &_position_z[begin],
+            &_rotation_x[begin], &_rotation_y[begin], &_rotation_z[begin], &_rotation_w[begin],
+            &_scale_x[begin], &_scale_y[begin], &_scale_z[begin],
+            &_local[begin]);
+    });
+
+    // a level is finished before the next one starts, so parents always have
+    // an up to date world matrix and dirty flag when their children read them
+    for (auto& level: _levels)
+    {
+        jobs.parallel_for(level.size(), batch_size, [&](std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; i++)
+            {
+                auto entity = level[i];
+                auto parent = _parents[entity];
+
+                if (parent != no_entity && _dirty[parent])
+                    _dirty[entity] = 1;
+
+                if (!_dirty[entity])
+                    continue;
+
+                if (parent == no_entity)
+                    _world[entity] = _local[entity];
+                else
+                    multiply_transform(_world[parent], _local[entity], _world[entity]);
+
+                _world_bounds[entity] = transform_bounds(
+                    _world[entity],
+                    _local_bounds[entity]);
+            }
+        });
+    }
+
+    std::fill(_dirty.begin(), _dirty.end(), 0);
+    _any_dirty = false;
+}
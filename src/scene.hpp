@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <job-system.hpp>
+#include <transform.hpp>
+
+using Entity = std::uint32_t;
+
+constexpr Entity no_entity = ~Entity(0);
+
+// transforms are kept as structure-of-arrays, so the world matrix update can
+// work on contiguous batches of entities
+class Scene
+{
+public:
+    Entity create_entity(Entity parent = no_entity, Bounds local_bounds = Bounds());
+
+    void set_position(Entity entity, glm::vec3 position);
+    void set_rotation(Entity entity, glm::quat rotation);
+    void set_scale(Entity entity, glm::vec3 scale);
+    void set_local_bounds(Entity entity, Bounds bounds);
+
+    glm::vec3 position(Entity entity) const;
+    glm::quat rotation(Entity entity) const;
+    glm::vec3 scale(Entity entity) const;
+
+    Entity parent(Entity entity) const
+    {
+        return _parents[entity];
+    }
+
+    const glm::mat4& world(Entity entity) const
+    {
+        return _world[entity];
+    }
+
+    const Bounds& world_bounds(Entity entity) const
+    {
+        return _world_bounds[entity];
+    }
+
+    // indexed by entity
+    const std::vector<glm::mat4>& world() const
+    {
+        return _world;
+    }
+
+    const std::vector<Bounds>& world_bounds() const
+    {
+        return _world_bounds;
+    }
+
+    std::size_t size() const
+    {
+        return _parents.size();
+    }
+
+    // recomputes the world matrix and bounds of every entity that changed
+    // since the last update, or whose parent did
+    void update(JobSystem& jobs);
+
+private:
+    static constexpr std::size_t batch_size = 1024;
+
+    void mark_dirty(Entity entity);
+
+    std::vector<float> _position_x;
+    std::vector<float> _position_y;
+    std::vector<float> _position_z;
+
+    std::vector<float> _rotation_x;
+    std::vector<float> _rotation_y;
+    std::vector<float> _rotation_z;
+    std::vector<float> _rotation_w;
+
+    std::vector<float> _scale_x;
+    std::vector<float> _scale_y;
+    std::vector<float> _scale_z;
+
+    std::vector<Entity> _parents;
+    std::vector<std::uint8_t> _dirty;
+
+    std::vector<glm::mat4> _local;
+    std::vector<glm::mat4> _world;
+    std::vector<Bounds> _local_bounds;
+    std::vector<Bounds> _world_bounds;
+
+    // entities grouped by hierarchy depth, a level only depends on the
+    // level before it
+    std::vector<std::vector<Entity>> _levels;
+    std::vector<std::uint32_t> _depths;
+
+    bool _any_dirty = false;
+};
@@ -1,18 +1,38 @@
 #include <settings.hpp>
 
 #include <fstream>
+#include <stdexcept>
 
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
 using json = nlohmann::json;
 
+static json vec3_to_json(const glm::vec3& v)
+{
+    return json::array({v.x, v.y, v.z});
+}
+
+static void vec3_from_json(const json& j, const char* key, glm::vec3& v)
+{
+    if (!j.contains(key))
+        return;
+
+    auto& values = j.at(key);
+    values.at(0).get_to(v.x);
+    values.at(1).get_to(v.y);
+    values.at(2).get_to(v.z);
+}
+
 void to_json(json& j, const ObjectSettings& s)
 {
     j = json
     {
         {"model", s.model},
-        {"texture", s.texture}
+        {"texture", s.texture},
+        {"position", vec3_to_json(s.position)},
+        {"rotation", vec3_to_json(s.rotation)},
+        {"scale", vec3_to_json(s.scale)}
     };
 }
 
@@ -20,6 +40,9 @@ void from_json(const json& j, ObjectSettings& s)
 {
     j.at("model").get_to(s.model);
     j.at("texture").get_to(s.texture);
+    vec3_from_json(j, "position", s.position);
+    vec3_from_json(j, "rotation", s.rotation);
+    vec3_from_json(j, "scale", s.scale);
 }
 
 void to_json(json& j, const SunSettings& s)
@@ -39,25 +62,144 @@ void from_json(const json& j, SunSettings& s)
     j.at("fragment-shader").get_to(s.fragment_shader);
 }
 
+void to_json(json& j, const TerrainSettings& s)
+{
+    j = json
+    {
+        {"texture", s.texture},
+        {"heightmap", s.heightmap},
+        {"chunk-size", s.chunk_size},
+        {"chunk-resolution", s.chunk_resolution},
+        {"view-distance", s.view_distance},
+        {"lod-levels", s.lod_levels},
+        {"lod-distance", s.lod_distance},
+        {"base-height", s.base_height},
+        {"height-scale", s.height_scale},
+        {"heightmap-scale", s.heightmap_scale},
+        {"texture-scale", s.texture_scale},
+        {"builds-per-frame", s.builds_per_frame}
+    };
+}
+
+void from_json(const json& j, TerrainSettings& s)
+{
+    s.enabled = true;
+    j.at("texture").get_to(s.texture);
+    s.heightmap = j.value("heightmap", s.heightmap);
+    s.chunk_size = j.value("chunk-size", s.chunk_size);
+    s.chunk_resolution = j.value("chunk-resolution", s.chunk_resolution);
+    s.view_distance = j.value("view-distance", s.view_distance);
+    s.lod_levels = j.value("lod-levels", s.lod_levels);
+    s.lod_distance = j.value("lod-distance", s.lod_distance);
+    s.base_height = j.value("base-height", s.base_height);
+    s.height_scale = j.value("height-scale", s.height_scale);
+    s.heightmap_scale = j.value("heightmap-scale", s.heightmap_scale);
+    s.texture_scale = j.value("texture-scale", s.texture_scale);
+    s.builds_per_frame = j.value("builds-per-frame", s.builds_per_frame);
+}
+
+void to_json(json& j, const DynamicResolutionSettings& s)
+{
+    j = json
+    {
+        {"target-ms", s.target_ms},
+        {"min-scale", s.min_scale},
+        {"max-scale", s.max_scale},
+        {"adjust-frames", s.adjust_frames}
+    };
+}
+
+void from_json(const json& j, DynamicResolutionSettings& s)
+{
+    s.enabled = true;
+    s.target_ms = j.value("target-ms", s.target_ms);
+    s.min_scale = j.value("min-scale", s.min_scale);
+    s.max_scale = j.value("max-scale", s.max_scale);
+    s.adjust_frames = j.value("adjust-frames", s.adjust_frames);
+
+    if (s.target_ms <= 0.0f || s.min_scale <= 0.0f || s.min_scale > s.max_scale
+        || s.max_scale > 1.0f || s.adjust_frames < 1)
+    {
+        spdlog::error("dynamic-resolution needs target-ms > 0, 0 < min-scale <= max-scale <= 1 and adjust-frames >= 1");
+        throw std::invalid_argument("invalid dynamic resolution settings");
+    }
+}
+
+void to_json(json& j, const TextureStreamingSettings& s)
+{
+    j = json
+    {
+        {"budget-mb", s.budget_mb},
+        {"tail-size", s.tail_size},
+        {"mip-bias", s.mip_bias},
+        {"loads-per-frame", s.loads_per_frame}
+    };
+}
+
+void from_json(const json& j, TextureStreamingSettings& s)
+{
+    s.enabled = true;
+    s.budget_mb = j.value("budget-mb", s.budget_mb);
+    s.tail_size = j.value("tail-size", s.tail_size);
+    s.mip_bias = j.value("mip-bias", s.mip_bias);
+    s.loads_per_frame = j.value("loads-per-frame", s.loads_per_frame);
+
+    if (s.budget_mb < 1 || s.tail_size < 1 || s.loads_per_frame < 1)
+    {
+        spdlog::error("texture-streaming needs budget-mb, tail-size and loads-per-frame >= 1");
+        throw std::invalid_argument("invalid texture streaming settings");
+    }
+}
+
 void to_json(json& j, const Settings& s)
 {
     j = json
     {
         {"root-folder", s.root_folder},
+        {"cooked-folder", s.cooked_folder},
         {"vertex-shader", s.vertex_shader},
         {"fragment-shader", s.fragment_shader},
         {"objects", s.objects},
-        {"sun", s.sun}
+        {"sun", s.sun},
+        {"vsync", s.vsync},
+        {"tick-rate", s.tick_rate}
     };
+
+    if (s.terrain.enabled)
+        j["terrain"] = s.terrain;
+
+    if (s.dynamic_resolution.enabled)
+        j["dynamic-resolution"] = s.dynamic_resolution;
+
+    if (s.texture_streaming.enabled)
+        j["texture-streaming"] = s.texture_streaming;
 }
 
 void from_json(const json& j, Settings& s)
 {
     j.at("root-folder").get_to(s.root_folder);
+    s.cooked_folder = j.value("cooked-folder", s.cooked_folder);
     j.at("vertex-shader").get_to(s.vertex_shader);
     j.at("fragment-shader").get_to(s.fragment_shader);
     j.at("objects").get_to(s.objects);
     j.at("sun").get_to(s.sun);
+    s.vsync = j.value("vsync", s.vsync);
+    s.tick_rate = j.value("tick-rate", s.tick_rate);
+
+    if (s.tick_rate <= 0.0)
+    {
+        spdlog::error("tick-rate must be positive, got {}", s.tick_rate);
+        throw std::invalid_argument("invalid tick rate");
+    }
+
+    if (j.contains("terrain"))
+        j.at("terrain").get_to(s.terrain);
+
+    if (j.contains("dynamic-resolution"))
+        j.at("dynamic-resolution").get_to(s.dynamic_resolution);
+
+    if (j.contains("texture-streaming"))
+        j.at("texture-streaming").get_to(s.texture_streaming);
 }
 
 Settings load_settings(const std::string& filename)
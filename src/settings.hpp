@@ -3,12 +3,16 @@
 #include <string>
 #include <vector>
 
+#include <glm/glm.hpp>
 #include <nlohmann/json.hpp>
 
 struct ObjectSettings
 {
     std::string model;
     std::string texture;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 rotation = glm::vec3(0.0f); // euler angles, in degrees
+    glm::vec3 scale = glm::vec3(1.0f);
 };
 
 struct SunSettings
@@ -18,13 +22,71 @@ struct SunSettings
     std::string fragment_shader;
 };
 
+struct TerrainSettings
+{
+    bool enabled = false;
+    std::string texture;
+    std::string heightmap; // grayscale image repeated over the world, noise when empty
+    float chunk_size = 16.0f; // world units per chunk side
+    int chunk_resolution = 16; // quads per chunk side at the finest level
+    int view_distance = 4; // in chunks around the camera
+    int lod_levels = 3;
+    int lod_distance = 2; // chunks per level of detail ring
+    float base_height = -0.5f;
+    float height_scale = 1.5f;
+    float heightmap_scale = 0.25f; // world units per heightmap texel
+    float texture_scale = 2.0f; // world units per texture repeat
+    int builds_per_frame = 4;
+};
+
+// renders into an offscreen target whose size follows the measured GPU
+// time, then upscales it to the window
+struct DynamicResolutionSettings
+{
+    bool enabled = false;
+    float target_ms = 14.0f; // GPU time per frame to stay under
+    float min_scale = 0.5f; // of the window size, on each axis
+    float max_scale = 1.0f;
+    int adjust_frames = 8; // frames averaged between two decisions
+};
+
+// keeps only the coarse mips of the object textures resident and reads the
+// finer ones as the objects get close, under a fixed memory budget
+struct TextureStreamingSettings
+{
+    bool enabled = false;
+    int budget_mb = 64; // for the streamed levels of every texture
+    int tail_size = 64; // largest level that is always resident
+    float mip_bias = 0.0f; // added to the level picked from the screen size
+    int loads_per_frame = 2; // reads started per frame
+};
+
 struct Settings
 {
     std::string root_folder;
+    std::string cooked_folder = "cooked"; // inside root_folder, written by the cook tool
     std::string vertex_shader;
     std::string fragment_shader;
     std::vector<ObjectSettings> objects;
     SunSettings sun;
+    TerrainSettings terrain;
+    DynamicResolutionSettings dynamic_resolution;
+    TextureStreamingSettings texture_streaming;
+    bool vsync = true;
+    double tick_rate = 60.0;
 };
 
+void to_json(nlohmann::json& j, const ObjectSettings& s);
+void from_json(const nlohmann::json& j, ObjectSettings& s);
+void to_json(nlohmann::json& j, const SunSettings& s);
+void from_json(const nlohmann::json& j, SunSettings& s);
+void to_json(nlohmann::json& j, const TerrainSettings& s);
+void from_json(const nlohmann::json& j, TerrainSettings& s);
+void to_json(nlohmann::json& j, const DynamicResolutionSettings& s);
+void from_json(const nlohmann::json& j, DynamicResolutionSettings& s);
+void to_json(nlohmann::json& j, const TextureStreamingSettings& s);
+void from_json(const nlohmann::json& j, TextureStreamingSettings& s);
+void to_json(nlohmann::json& j, const Settings& s);
+void from_json(const nlohmann::json& j, Settings& s);
+
 Settings load_settings(const std::string& filename);
@@ -0,0 +1,257 @@
+#include <simulation.hpp>
+
+#include <cmath>
+#include <stdexcept>
+
+#include <glm/gtc/quaternion.hpp>
+#include <spdlog/spdlog.h>
+
+#include <allocation-tracker.hpp>
+
+// degrees per second, matches the old one degree per frame at 60 fps
+constexpr float turn_speed = 60.0f;
+constexpr double light_period = 3.5;
+constexpr std::size_t interpolate_batch_size = 1024;
+
+// cosine of the largest turn between two ticks that is still blended, more
+// than that is a jump, like the light pivot going back to its start
+constexpr float max_blend_cos = 0.866f; // 30 degrees
+
+// whether some axis of the matrix turned more than max_blend_cos between a
+// and b, scale does not count
+static bool turned_too_far(const glm::mat4& a, const glm::mat4& b)
+{
+    for (int k = 0; k < 3; k++)
+    {
+        auto axis_a = glm::vec3(a[k]);
+        auto axis_b = glm::vec3(b[k]);
+        auto dot = glm::dot(axis_a, axis_b);
+
+        auto lengths = glm::dot(axis_a, axis_a) * glm::dot(axis_b, axis_b);
+
+        if (dot < 0.0f || dot * dot < max_blend_cos * max_blend_cos * lengths)
+            return true;
+    }
+
+    return false;
+}
+
+void interpolate(
+    JobSystem& jobs,
+    const Snapshot& from, const Snapshot& to, float alpha,
+    Snapshot& out)
+{
+    out.time = glm::mix(from.time, to.time, (double) alpha);
+    out.tick = to.tick;
+
+    // the blend only shows an edit once both ends have it
+    out.edits = from.edits;
+
+    out.camera_pos = glm::mix(from.camera_pos, to.camera_pos, alpha);
+    out.camera_front = glm::normalize(glm::mix(from.camera_front, to.camera_front, alpha));
+    out.camera_up = to.camera_up;
+
+    auto count = to.world.size();
+    out.world.resize(count);
+    out.world_bounds.resize(count);
+
+    // entities created between the two ticks have nothing to blend from
+    if (from.world.size() != count)
+    {
+        out.world = to.world;
+        out.world_bounds = to.world_bounds;
+        return;
+    }
+
+    // a component wise blend is not a proper rotation, but ticks are close
+    // enough together that the difference is not visible. jumps are not
+    // blended at all, halfway through one the matrix would shrink
+    jobs.parallel_for(count, interpolate_batch_size, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++)
+        {
+            if (turned_too_far(from.world[i], to.world[i]))
+            {
+                out.world[i] = to.world[i];
+                out.world_bounds[i] = to.world_bounds[i];
+                continue;
+            }
+
+            out.world[i] = from.world[i] * (1.0f - alpha) + to.world[i] * alpha;
+            out.world_bounds[i].min = glm::mix(from.world_bounds[i].min, to.world_bounds[i].min, alpha);
+            out.world_bounds[i].max = glm::mix(from.world_bounds[i].max, to.world_bounds[i].max, alpha);
+        }
+    });
+}
+
+Simulation::Simulation(
+    JobSystem& jobs, Scene& scene, Camera camera,
+    Entity light_pivot, double tick_rate)
+    : _jobs(jobs), _scene(scene), _camera(camera), _light_pivot(light_pivot)
+{
+    _tick_interval = 1.0 / tick_rate;
+    _start = std::chrono::steady_clock::now();
+}
+
+Simulation::~Simulation()
+{
+    stop();
+}
+
+void Simulation::start()
+{
+    if (_running)
+        return;
+
+    _start = std::chrono::steady_clock::now();
+
+    // the renderer needs two snapshots to blend between before the thread
+    // produces any
+    _scene.update(_jobs);
+    publish(0.0);
+    _snapshots.acquire();
+    publish(0.0);
+    _snapshots.acquire();
+
+    _running = true;
+    _thread = std::thread(&Simulation::loop, this);
+
+    spdlog::info("simulation running at {} ticks per second", 1.0 / _tick_interval);
+}
+
+void Simulation::stop()
+{
+    if (!_running)
+        return;
+
+    _running = false;
+    _thread.join();
+}
+
+double Simulation::now() const
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+    return elapsed.count();
+}
+
+void Simulation::loop()
+{
+    AllocationScope scope(AllocationTag::simulation);
+
+    auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(_tick_interval));
+
+    auto next_tick = _start + interval;
+
+    while (_running)
+    {
+        std::this_thread::sleep_until(next_tick);
+
+        step((float) _tick_interval);
+        _tick++;
+
+        std::chrono::duration<double> tick_time = next_tick - _start;
+        publish(tick_time.count());
+
+        next_tick += interval;
+
+        auto behind = std::chrono::steady_clock::now() - next_tick;
+
+        if (behind > interval * max_ticks_behind)
+        {
+            spdlog::warn("simulation fell {} ticks behind, skipping ahead",
+                behind / interval);
+            next_tick = std::chrono::steady_clock::now() + interval;
+        }
+    }
+}
+
+void Simulation::advance()
+{
+    if (_running)
+        throw std::logic_error("cannot advance a running simulation");
+
+    AllocationScope scope(AllocationTag::simulation);
+
+    step((float) _tick_interval);
+    _tick++;
+    publish(_tick * _tick_interval);
+}
+
+std::uint64_t Simulation::edit(std::function<void(Scene&)> edit)
+{
+    std::lock_guard<std::mutex> lock(_edits_mutex);
+
+    _edits.push_back(std::move(edit));
+    return ++_posted_edits;
+}
+
+void Simulation::apply_edits()
+{
+    // edits run outside the lock, so posting never waits for a slow one
+    {
+        std::lock_guard<std::mutex> lock(_edits_mutex);
+        _running_edits.swap(_edits);
+    }
+
+    for (auto& edit: _running_edits)
+        edit(_scene);
+
+    _applied_edits += _running_edits.size();
+    _running_edits.clear();
+}
+
+void Simulation::step(float dt)
+{
+    apply_edits();
+
+    auto input = _input.load(std::memory_order_relaxed);
+
+    if (input & input_move_front)
+        _camera.move_front(dt);
+
+    if (input & input_move_back)
+        _camera.move_back(dt);
+
+    if (input & input_move_left)
+        _camera.move_left(dt);
+
+    if (input & input_move_right)
+        _camera.move_right(dt);
+
+    if (input & input_turn_up)
+        _camera.turn(0.0f, turn_speed * dt);
+
+    if (input & input_turn_down)
+        _camera.turn(0.0f, -turn_speed * dt);
+
+    if (input & input_turn_left)
+        _camera.turn(-turn_speed * dt, 0.0f);
+
+    if (input & input_turn_right)
+        _camera.turn(turn_speed * dt, 0.0f);
+
+    _light_time += dt;
+    auto angle = (float) std::fmod(_light_time, light_period);
+    _scene.set_rotation(_light_pivot, glm::angleAxis(angle, glm::vec3(-1.0f, 0.0f, 0.0f)));
+
+    _scene.update(_jobs);
+}
+
+void Simulation::publish(double time)
+{
+    auto& snapshot = _snapshots.back();
+
+    snapshot.time = time;
+    snapshot.tick = _tick;
+    snapshot.edits = _applied_edits;
+    snapshot.camera_pos = _camera.pos();
+    snapshot.camera_front = _camera.front();
+    snapshot.camera_up = _camera.up();
+
+    // the slots keep their capacity, so this only allocates when entities
+    // were added
+    snapshot.world = _scene.world();
+    snapshot.world_bounds = _scene.world_bounds();
+
+    _snapshots.publish();
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <camera.hpp>
+#include <job-system.hpp>
+#include <scene.hpp>
+#include <snapshot-buffer.hpp>
+#include <transform.hpp>
+
+enum InputAction : std::uint32_t
+{
+    input_move_front = 1 << 0,
+    input_move_back = 1 << 1,
+    input_move_left = 1 << 2,
+    input_move_right = 1 << 3,
+    input_turn_up = 1 << 4,
+    input_turn_down = 1 << 5,
+    input_turn_left = 1 << 6,
+    input_turn_right = 1 << 7
+};
+
+// everything the renderer needs from one simulation tick
+struct Snapshot
+{
+    double time = 0.0;
+    std::uint64_t tick = 0;
+
+    // scene edits applied up to this tick, see Simulation::edit
+    std::uint64_t edits = 0;
+
+    glm::vec3 camera_pos = glm::vec3(0.0f);
+    glm::vec3 camera_front = glm::vec3(0.0f, 0.0f, -1.0f);
+    glm::vec3 camera_up = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    std::vector<glm::mat4> world;
+    std::vector<Bounds> world_bounds;
+};
+
+// blends two ticks for the render thread, out keeps its buffers between calls
+void interpolate(
+    JobSystem& jobs,
+    const Snapshot& from, const Snapshot& to, float alpha,
+    Snapshot& out);
+
+// steps the camera and the scene animation at a fixed rate on its own
+// thread. the scene belongs to the simulation thread between start and stop
+class Simulation
+{
+public:
+    Simulation(
+        JobSystem& jobs, Scene& scene, Camera camera,
+        Entity light_pivot, double tick_rate = 60.0);
+
+    Simulation(const Simulation& other) = delete;
+    Simulation& operator = (const Simulation& other) = delete;
+
+    ~Simulation();
+
+    void start();
+    void stop();
+
+    // runs and publishes a single tick on the calling thread, for offline
+    // rendering where there is no simulation thread
+    void advance();
+
+    // runs edit on the scene before the next tick, on the simulation thread
+    // while it is running. returns the Snapshot::edits of the first tick
+    // that includes the edit
+    std::uint64_t edit(std::function<void(Scene&)> edit);
+
+    // bitmask of InputAction, sampled by the window thread
+    void set_input(std::uint32_t actions)
+    {
+        _input.store(actions, std::memory_order_relaxed);
+    }
+
+    // seconds since start on the same clock as Snapshot::time
+    double now() const;
+
+    double tick_interval() const
+    {
+        return _tick_interval;
+    }
+
+    SnapshotBuffer<Snapshot>& snapshots()
+    {
+        return _snapshots;
+    }
+
+private:
+    // if the simulation falls behind by more than this many ticks it skips
+    // ahead instead of trying to catch up
+    static constexpr int max_ticks_behind = 5;
+
+    void loop();
+    void apply_edits();
+    void step(float dt);
+    void publish(double time);
+
+    JobSystem& _jobs;
+    Scene& _scene;
+    Camera _camera;
+    Entity _light_pivot;
+
+    double _tick_interval;
+    std::uint64_t _tick = 0;
+    double _light_time = 0.0;
+
+    std::chrono::steady_clock::time_point _start;
+    std::atomic<std::uint32_t> _input { 0 };
+    std::atomic<bool> _running { false };
+    std::thread _thread;
+
+    std::mutex _edits_mutex;
+    std::vector<std::function<void(Scene&)>> _edits;
+    std::vector<std::function<void(Scene&)>> _running_edits;
+    std::uint64_t _posted_edits = 0;
+    std::uint64_t _applied_edits = 0;
+
+    SnapshotBuffer<Snapshot> _snapshots;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+
+// hands whole snapshots from one writer thread to one reader thread without
+// locks or copies. there are four slots: the one being written, the latest
+// published one, and the two the reader interpolates between. every swap is a
+// single atomic exchange, so each slot always has exactly one owner
+template <typename T>
+class SnapshotBuffer
+{
+public:
+    // slot the writer fills before calling publish
+    T& back()
+    {
+        return _slots[_back];
+    }
+
+    void publish()
+    {
+        auto previous = _latest.exchange(_back | fresh_bit, std::memory_order_acq_rel);
+        _back = previous & index_mask;
+    }
+
+    // moves the latest published snapshot to current and the old current
+    // to previous, returns false when nothing new was published
+    bool acquire()
+    {
+        if ((_latest.load(std::memory_order_relaxed) & fresh_bit) == 0)
+            return false;
+
+        auto latest = _latest.exchange(_previous, std::memory_order_acq_rel);
+        _previous = _current;
+        _current = latest & index_mask;
+
+        return true;
+    }
+
+    const T& current() const
+    {
+        return _slots[_current];
+    }
+
+    const T& previous() const
+    {
+        return _slots[_previous];
+    }
+
+private:
+    static constexpr unsigned int fresh_bit = 4;
+    static constexpr unsigned int index_mask = 3;
+
+    T _slots[4];
+
+    unsigned int _back = 0;
+    std::atomic<unsigned int> _latest { 1 };
+    unsigned int _current = 2;
+    unsigned int _previous = 3;
+};
@@ -0,0 +1,689 @@
+#include <software-backend.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SOFTWARE_BACKEND_SSE
+#include <emmintrin.h>
+#endif
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include <stb_image_write.h>
+
+// constants of shaders/phong.frag
+constexpr float ambient_strength = 0.1f;
+constexpr float specular_strength = 0.7f;
+
+constexpr std::size_t transform_batch_size = 256;
+
+namespace
+{
+    struct ClipVertex
+    {
+        glm::vec4 clip;
+        float attributes[8];
+    };
+
+    ClipVertex lerp_vertex(const ClipVertex& a, const ClipVertex& b, float t)
+    {
+        ClipVertex out;
+        out.clip = a.clip + (b.clip - a.clip) * t;
+
+        for (int i = 0; i < 8; i++)
+            out.attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t;
+
+        return out;
+    }
+
+    // keeps the part of the triangle in front of the near plane, which can be
+    // a quad
+    int clip_near(const ClipVertex in[3], ClipVertex out[4])
+    {
+        int count = 0;
+
+        for (int i = 0; i < 3; i++)
+        {
+            auto& a = in[i];
+            auto& b = in[(i + 1) % 3];
+
+            auto distance_a = a.clip.z + a.clip.w;
+            auto distance_b = b.clip.z + b.clip.w;
+
+            if (distance_a >= 0.0f)
+                out[count++] = a;
+
+            if ((distance_a >= 0.0f) != (distance_b >= 0.0f))
+                out[count++] = lerp_vertex(a, b, distance_a / (distance_a - distance_b));
+        }
+
+        return count;
+    }
+
+    // true when every corner is outside the same side of the view volume
+    bool trivially_outside(const ClipVertex corners[3])
+    {
+        auto all = [&](auto outside) {
+            return outside(corners[0].clip)
+                && outside(corners[1].clip)
+                && outside(corners[2].clip);
+        };
+
+        return all([](const glm::vec4& c) { return c.x > c.w; })
+            || all([](const glm::vec4& c) { return c.x < -c.w; })
+            || all([](const glm::vec4& c) { return c.y > c.w; })
+            || all([](const glm::vec4& c) { return c.y < -c.w; })
+            || all([](const glm::vec4& c) { return c.z > c.w; });
+    }
+
+    // bilinear filtering with repeat wrapping, like the GL textures
+    void sample_texture(const Image& image, float u, float v, float rgb[3])
+    {
+        auto x = u * image.width - 0.5f;
+        auto y = v * image.height - 0.5f;
+
+        auto x_floor = std::floor(x);
+        auto y_floor = std::floor(y);
+        auto fx = x - x_floor;
+        auto fy = y - y_floor;
+
+        auto wrap = [](int value, int size) {
+            value %= size;
+            return value < 0 ? value + size : value;
+        };
+
+        int x0 = wrap((int) x_floor, image.width);
+        int y0 = wrap((int) y_floor, image.height);
+        int x1 = wrap(x0 + 1, image.width);
+        int y1 = wrap(y0 + 1, image.height);
+
+        auto pixels = image.pixels.get();
+        auto channels = image.channels;
+
+        for (int c = 0; c < 3; c++)
+        {
+            auto channel = std::min(c, channels - 1);
+            float p00 = pixels[(y0 * image.width + x0) * channels + channel];
+            float p10 = pixels[(y0 * image.width + x1) * channels + channel];
+            float p01 = pixels[(y1 * image.width + x0) * channels + channel];
+            float p11 = pixels[(y1 * image.width + x1) * channels + channel];
+
+            auto top = p00 + (p10 - p00) * fx;
+            auto bottom = p01 + (p11 - p01) * fx;
+            rgb[c] = (top + (bottom - top) * fy) * (1.0f / 255.0f);
+        }
+    }
+
+#ifdef SOFTWARE_BACKEND_SSE
+    __m128 dot3(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+    }
+
+    void normalize3(__m128& x, __m128& y, __m128& z)
+    {
+        auto length = _mm_sqrt_ps(dot3(x, y, z, x, y, z));
+        auto inv_length = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(length, _mm_set1_ps(1e-12f)));
+
+        x = _mm_mul_ps(x, inv_length);
+        y = _mm_mul_ps(y, inv_length);
+        z = _mm_mul_ps(z, inv_length);
+    }
+#endif // SOFTWARE_BACKEND_SSE
+}
+
+SoftwareBackend::SoftwareBackend(JobSystem& jobs, int width, int height)
+    : _jobs(jobs)
+{
+    if (width <= 0 || height <= 0)
+        throw std::invalid_argument("software backend needs a positive resolution");
+
+    _width = width;
+    _height = height;
+    _stride = (width + 1) & ~1;
+    _padded_height = (height + 1) & ~1;
+
+    _tiles_x = (_stride + tile_size - 1) / tile_size;
+    _tiles_y = (_padded_height + tile_size - 1) / tile_size;
+
+    _color.resize(_stride * _padded_height);
+    _depth.resize(_stride * _padded_height);
+    _bins.resize(_tiles_x * _tiles_y);
+    _tile_fragments.resize(_tiles_x * _tiles_y);
+}
+
+void SoftwareBackend::draw_frame(const FrameData& frame)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    _light_world_pos = glm::vec3(frame.light_rot * glm::vec4(frame.light_pos, 1.0f));
+
+    if (frame.commands != nullptr)
+    {
+        transform_triangles(frame);
+        bin_triangles();
+    }
+    else
+    {
+        _triangles.clear();
+
+        for (auto& bin: _bins)
+            bin.clear();
+    }
+
+    _jobs.parallel_for(_bins.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (auto tile = begin; tile < end; tile++)
+            raster_tile((int) tile, frame);
+    });
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    _stats.seconds = elapsed.count();
+    _stats.triangles = 0;
+    _stats.fragments = 0;
+
+    for (auto& triangle: _triangles)
+        _stats.triangles += triangle.valid;
+
+    for (auto fragments: _tile_fragments)
+        _stats.fragments += fragments;
+}
+
+void SoftwareBackend::transform_triangles(const FrameData& frame)
+{
+    auto commands = frame.commands;
+    auto count = frame.command_count;
+
+    _command_offsets.resize(count + 1);
+    _command_offsets[0] = 0;
+
+    for (std::size_t i = 0; i < count; i++)
+        _command_offsets[i + 1] = _command_offsets[i] + commands[i].model->vertex_count() / 3;
+
+    auto total = _command_offsets.back();
+    _triangles.resize(total * 2);
+
+    auto view_projection = frame.projection * frame.view;
+
+    _jobs.parallel_for(total, transform_batch_size, [&](std::size_t begin, std::size_t end) {
+        std::size_t command_index = std::upper_bound(
+            _command_offsets.begin(), _command_offsets.end(), begin)
+            - _command_offsets.begin() - 1;
+
+        for (auto i = begin; i < end; i++)
+        {
+            while (i >= _command_offsets[command_index + 1])
+                command_index++;
+
+            auto& command = commands[command_index];
+            auto model_view_projection = view_projection * command.world;
+            auto first_vertex = (i - _command_offsets[command_index]) * 3;
+            auto vertices = command.model->vertices();
+
+            auto& first = _triangles[i * 2];
+            auto& second = _triangles[i * 2 + 1];
+            first.valid = false;
+            second.valid = false;
+
+            ClipVertex corners[3];
+
+            for (int k = 0; k < 3; k++)
+            {
+                auto v = vertices + (first_vertex + k) * CsvModel::floats_per_vertex;
+                glm::vec4 position(
+                    v[CsvModel::position_offset],
+                    v[CsvModel::position_offset + 1],
+                    v[CsvModel::position_offset + 2],
+                    1.0f);
+
+                corners[k].clip = model_view_projection * position;
+
+                // the vertex shader passes the normal through untransformed
+                auto world_pos = command.world * position;
+                auto attributes = corners[k].attributes;
+                attributes[0] = world_pos.x;
+                attributes[1] = world_pos.y;
+                attributes[2] = world_pos.z;
+                attributes[3] = v[CsvModel::normal_offset];
+                attributes[4] = v[CsvModel::normal_offset + 1];
+                attributes[5] = v[CsvModel::normal_offset + 2];
+                attributes[6] = v[CsvModel::tex_coord_offset];
+                attributes[7] = v[CsvModel::tex_coord_offset + 1];
+            }
+
+            if (trivially_outside(corners))
+                continue;
+
+            ClipVertex clipped[4];
+            auto count = clip_near(corners, clipped);
+
+            if (count < 3)
+                continue;
+
+            // a clipped quad is split as a fan around its first corner
+            for (int t = 0; t + 2 < count; t++)
+            {
+                auto& out = t == 0 ? first : second;
+                auto& b = clipped[t + 1];
+                auto& c = clipped[t + 2];
+
+                glm::vec4 clip[3] = { clipped[0].clip, b.clip, c.clip };
+                const float* attributes[3] = { clipped[0].attributes, b.attributes, c.attributes };
+
+                out.texture = command.model->texture();
+                out.shading = command.shading;
+                setup_triangle(clip, attributes, out);
+            }
+        }
+    });
+}
+
+void SoftwareBackend::setup_triangle(
+    const glm::vec4 clip[3], const float* attributes[3], Triangle& out) const
+{
+    for (int k = 0; k < 3; k++)
+    {
+        auto inv_w = 1.0f / clip[k].w;
+
+        out.x[k] = (clip[k].x * inv_w * 0.5f + 0.5f) * _width;
+        out.y[k] = (0.5f - clip[k].y * inv_w * 0.5f) * _height;
+        out.z[k] = clip[k].z * inv_w * 0.5f + 0.5f;
+        out.inv_w[k] = inv_w;
+
+        for (int i = 0; i < attribute_count; i++)
+            out.attributes[k][i] = attributes[k][i] * inv_w;
+    }
+
+    auto area = (out.x[1] - out.x[0]) * (out.y[2] - out.y[0])
+        - (out.y[1] - out.y[0]) * (out.x[2] - out.x[0]);
+
+    if (!(std::fabs(area) > 1e-8f))
+        return;
+
+    // faces are not culled, so the winding is flipped to keep the edge
+    // functions positive inside
+    if (area < 0.0f)
+    {
+        std::swap(out.x[1], out.x[2]);
+        std::swap(out.y[1], out.y[2]);
+        std::swap(out.z[1], out.z[2]);
+        std::swap(out.inv_w[1], out.inv_w[2]);
+        std::swap(out.attributes[1], out.attributes[2]);
+    }
+
+    auto min_x = std::min({ out.x[0], out.x[1], out.x[2] });
+    auto max_x = std::max({ out.x[0], out.x[1], out.x[2] });
+    auto min_y = std::min({ out.y[0], out.y[1], out.y[2] });
+    auto max_y = std::max({ out.y[0], out.y[1], out.y[2] });
+
+    out.min_x = std::max((int) std::floor(min_x), 0);
+    out.min_y = std::max((int) std::floor(min_y), 0);
+    out.max_x = std::min((int) std::ceil(max_x), _width - 1);
+    out.max_y = std::min((int) std::ceil(max_y), _height - 1);
+
+    out.valid = out.min_x <= out.max_x && out.min_y <= out.max_y;
+}
+
+void SoftwareBackend::bin_triangles()
+{
+    for (auto& bin: _bins)
+        bin.clear();
+
+    for (std::size_t i = 0; i < _triangles.size(); i++)
+    {
+        auto& triangle = _triangles[i];
+
+        if (!triangle.valid)
+            continue;
+
+        for (int ty = triangle.min_y / tile_size; ty <= triangle.max_y / tile_size; ty++)
+            for (int tx = triangle.min_x / tile_size; tx <= triangle.max_x / tile_size; tx++)
+                _bins[ty * _tiles_x + tx].push_back((std::uint32_t) i);
+    }
+}
+
+void SoftwareBackend::raster_tile(int tile, const FrameData& frame)
+{
+    int x0 = (tile % _tiles_x) * tile_size;
+    int y0 = (tile / _tiles_x) * tile_size;
+    int x1 = std::min(x0 + tile_size, _stride);
+    int y1 = std::min(y0 + tile_size, _padded_height);
+
+    for (int y = y0; y < y1; y++)
+    {
+        std::fill(&_color[y * _stride + x0], &_color[y * _stride + x1], 0xff000000u);
+        std::fill(&_depth[y * _stride + x0], &_depth[y * _stride + x1], 1.0f);
+    }
+
+    _tile_fragments[tile] = 0;
+
+    for (auto index: _bins[tile])
+        raster_triangle(_triangles[index], frame, x0, y0, x1, y1);
+}
+
+void SoftwareBackend::raster_triangle(
+    const Triangle& triangle, const FrameData& frame,
+    int tile_x0, int tile_y0, int tile_x1, int tile_y1)
+{
+    // quads start on even pixels, tiles are even sized so they never cross
+    int x_begin = std::max(triangle.min_x, tile_x0) & ~1;
+    int y_begin = std::max(triangle.min_y, tile_y0) & ~1;
+    int x_end = std::min(triangle.max_x + 1, tile_x1);
+    int y_end = std::min(triangle.max_y + 1, tile_y1);
+
+    // edge k is opposite to vertex k, E(p) = a * p.x + b * p.y + c
+    float a[3], b[3], c[3];
+
+    for (int k = 0; k < 3; k++)
+    {
+        int from = (k + 1) % 3;
+        int to = (k + 2) % 3;
+
+        a[k] = triangle.y[from] - triangle.y[to];
+        b[k] = triangle.x[to] - triangle.x[from];
+        c[k] = -(a[k] * triangle.x[from] + b[k] * triangle.y[from]);
+    }
+
+    auto area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0])
+        - (triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+
+    auto light = _light_world_pos;
+    auto view = frame.view_pos;
+    auto is_phong = triangle.shading == ShadingModel::phong;
+
+    std::size_t fragments = 0;
+
+#ifdef SOFTWARE_BACKEND_SSE
+    __m128 edge_a[3], edge_b[3], edge_c[3];
+
+    for (int k = 0; k < 3; k++)
+    {
+        edge_a[k] = _mm_set1_ps(a[k]);
+        edge_b[k] = _mm_set1_ps(b[k]);
+        edge_c[k] = _mm_set1_ps(c[k]);
+    }
+
+    auto inv_area = _mm_set1_ps(1.0f / area);
+
+    const auto zero = _mm_setzero_ps();
+    const auto one = _mm_set1_ps(1.0f);
+    const auto quad_x = _mm_setr_ps(0.5f, 1.5f, 0.5f, 1.5f);
+    const auto quad_y = _mm_setr_ps(0.5f, 0.5f, 1.5f, 1.5f);
+
+    for (int y = y_begin; y < y_end; y += 2)
+    {
+        auto py = _mm_add_ps(_mm_set1_ps((float) y), quad_y);
+
+        for (int x = x_begin; x < x_end; x += 2)
+        {
+            auto px = _mm_add_ps(_mm_set1_ps((float) x), quad_x);
+
+            __m128 edge[3];
+
+            for (int k = 0; k < 3; k++)
+            {
+                edge[k] = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(edge_a[k], px), _mm_mul_ps(edge_b[k], py)),
+                    edge_c[k]);
+            }
+
+            auto inside = _mm_and_ps(
+                _mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)),
+                _mm_cmpge_ps(edge[2], zero));
+
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+
+            auto l0 = _mm_mul_ps(edge[0], inv_area);
+            auto l1 = _mm_mul_ps(edge[1], inv_area);
+            auto l2 = _mm_mul_ps(edge[2], inv_area);
+
+            auto interpolate = [&](float v0, float v1, float v2) {
+                return _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(l0, _mm_set1_ps(v0)), _mm_mul_ps(l1, _mm_set1_ps(v1))),
+                    _mm_mul_ps(l2, _mm_set1_ps(v2)));
+            };
+
+            auto z = interpolate(triangle.z[0], triangle.z[1], triangle.z[2]);
+
+            auto depth_row0 = &_depth[y * _stride + x];
+            auto depth_row1 = depth_row0 + _stride;
+
+            auto old_depth = _mm_loadh_pi(
+                _mm_loadl_pi(zero, (const __m64*) depth_row0),
+                (const __m64*) depth_row1);
+
+            auto pass = _mm_and_ps(inside, _mm_cmplt_ps(z, old_depth));
+            int pass_bits = _mm_movemask_ps(pass);
+
+            if (pass_bits == 0)
+                continue;
+
+            auto new_depth = _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, old_depth));
+            _mm_storel_pi((__m64*) depth_row0, new_depth);
+            _mm_storeh_pi((__m64*) depth_row1, new_depth);
+
+            __m128 red = one, green = one, blue = one;
+
+            if (is_phong)
+            {
+                // perspective correct attributes
+                auto w = _mm_div_ps(one, interpolate(
+                    triangle.inv_w[0], triangle.inv_w[1], triangle.inv_w[2]));
+
+                __m128 attributes[attribute_count];
+
+                for (int i = 0; i < attribute_count; i++)
+                {
+                    attributes[i] = _mm_mul_ps(w, interpolate(
+                        triangle.attributes[0][i],
+                        triangle.attributes[1][i],
+                        triangle.attributes[2][i]));
+                }
+
+                auto nx = attributes[3], ny = attributes[4], nz = attributes[5];
+                normalize3(nx, ny, nz);
+
+                auto lx = _mm_sub_ps(_mm_set1_ps(light.x), attributes[0]);
+                auto ly = _mm_sub_ps(_mm_set1_ps(light.y), attributes[1]);
+                auto lz = _mm_sub_ps(_mm_set1_ps(light.z), attributes[2]);
+                normalize3(lx, ly, lz);
+
+                auto n_dot_l = dot3(nx, ny, nz, lx, ly, lz);
+                auto diffuse = _mm_max_ps(n_dot_l, zero);
+
+                auto vx = _mm_sub_ps(_mm_set1_ps(view.x), attributes[0]);
+                auto vy = _mm_sub_ps(_mm_set1_ps(view.y), attributes[1]);
+                auto vz = _mm_sub_ps(_mm_set1_ps(view.z), attributes[2]);
+                normalize3(vx, vy, vz);
+
+                // reflect(-light, normal) = 2 * dot(n, l) * n - l
+                auto twice = _mm_add_ps(n_dot_l, n_dot_l);
+                auto rx = _mm_sub_ps(_mm_mul_ps(twice, nx), lx);
+                auto ry = _mm_sub_ps(_mm_mul_ps(twice, ny), ly);
+                auto rz = _mm_sub_ps(_mm_mul_ps(twice, nz), lz);
+
+                // pow(x, 32) as five squarings
+                auto specular = _mm_max_ps(dot3(vx, vy, vz, rx, ry, rz), zero);
+                for (int i = 0; i < 5; i++)
+                    specular = _mm_mul_ps(specular, specular);
+
+                // ambient, diffuse and specular all scale the same light color
+                auto intensity = _mm_add_ps(
+                    _mm_add_ps(_mm_set1_ps(ambient_strength), diffuse),
+                    _mm_mul_ps(_mm_set1_ps(specular_strength), specular));
+
+                alignas(16) float u[4], v[4];
+                alignas(16) float texel_r[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+                alignas(16) float texel_g[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+                alignas(16) float texel_b[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+                if (triangle.texture != nullptr)
+                {
+                    _mm_store_ps(u, attributes[6]);
+                    _mm_store_ps(v, attributes[7]);
+
+                    auto& image = triangle.texture->image();
+
+                    for (int lane = 0; lane < 4; lane++)
+                    {
+                        if ((pass_bits & (1 << lane)) == 0)
+                            continue;
+
+                        float rgb[3];
+                        sample_texture(image, u[lane], v[lane], rgb);
+                        texel_r[lane] = rgb[0];
+                        texel_g[lane] = rgb[1];
+                        texel_b[lane] = rgb[2];
+                    }
+                }
+
+                red = _mm_mul_ps(_mm_mul_ps(intensity, _mm_set1_ps(frame.light_color.x)), _mm_load_ps(texel_r));
+                green = _mm_mul_ps(_mm_mul_ps(intensity, _mm_set1_ps(frame.light_color.y)), _mm_load_ps(texel_g));
+                blue = _mm_mul_ps(_mm_mul_ps(intensity, _mm_set1_ps(frame.light_color.z)), _mm_load_ps(texel_b));
+            }
+
+            auto to_byte = [&](__m128 value) {
+                value = _mm_min_ps(_mm_max_ps(value, zero), one);
+                return _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(255.0f)));
+            };
+
+            // rgba bytes in memory order, alpha is always opaque
+            auto packed = _mm_or_si128(
+                _mm_or_si128(to_byte(red), _mm_slli_epi32(to_byte(green), 8)),
+                _mm_or_si128(_mm_slli_epi32(to_byte(blue), 16), _mm_set1_epi32((int) 0xff000000u)));
+
+            alignas(16) std::uint32_t colors[4];
+            _mm_store_si128((__m128i*) colors, packed);
+
+            auto color_row0 = &_color[y * _stride + x];
+            auto color_row1 = color_row0 + _stride;
+
+            if (pass_bits & 1) color_row0[0] = colors[0];
+            if (pass_bits & 2) color_row0[1] = colors[1];
+            if (pass_bits & 4) color_row1[0] = colors[2];
+            if (pass_bits & 8) color_row1[1] = colors[3];
+
+            fragments += (pass_bits & 1) + ((pass_bits >> 1) & 1)
+                + ((pass_bits >> 2) & 1) + ((pass_bits >> 3) & 1);
+        }
+    }
+#else
+    auto inv_area = 1.0f / area;
+
+    // the same lanes as the SSE quads, a pixel at a time
+    const float quad_x[4] = { 0.5f, 1.5f, 0.5f, 1.5f };
+    const float quad_y[4] = { 0.5f, 0.5f, 1.5f, 1.5f };
+
+    // the phong of shaders/phong.frag at barycentrics l, like the SSE path
+    auto shade = [&](float l0, float l1, float l2) {
+        auto interpolate = [&](float v0, float v1, float v2) {
+            return l0 * v0 + l1 * v1 + l2 * v2;
+        };
+
+        // perspective correct attributes
+        auto w = 1.0f / interpolate(triangle.inv_w[0], triangle.inv_w[1], triangle.inv_w[2]);
+
+        float attributes[attribute_count];
+
+        for (int i = 0; i < attribute_count; i++)
+        {
+            attributes[i] = w * interpolate(
+                triangle.attributes[0][i],
+                triangle.attributes[1][i],
+                triangle.attributes[2][i]);
+        }
+
+        glm::vec3 position(attributes[0], attributes[1], attributes[2]);
+        glm::vec3 normal(attributes[3], attributes[4], attributes[5]);
+
+        auto normalize = [](glm::vec3 v) {
+            return v / std::max(glm::length(v), 1e-12f);
+        };
+
+        auto n = normalize(normal);
+        auto l = normalize(light - position);
+        auto v = normalize(view - position);
+
+        auto n_dot_l = glm::dot(n, l);
+        auto diffuse = std::max(n_dot_l, 0.0f);
+
+        // reflect(-light, normal) = 2 * dot(n, l) * n - l, pow(x, 32) as five squarings
+        auto specular = std::max(glm::dot(v, 2.0f * n_dot_l * n - l), 0.0f);
+        for (int i = 0; i < 5; i++)
+            specular *= specular;
+
+        auto intensity = ambient_strength + diffuse + specular_strength * specular;
+        float texel[3] = { 1.0f, 1.0f, 1.0f };
+
+        if (triangle.texture != nullptr)
+            sample_texture(triangle.texture->image(), attributes[6], attributes[7], texel);
+
+        return glm::vec3(texel[0], texel[1], texel[2]) * intensity * frame.light_color;
+    };
+
+    auto to_byte = [](float value) {
+        return static_cast<std::uint32_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+    };
+
+    for (int y = y_begin; y < y_end; y += 2)
+    {
+        for (int x = x_begin; x < x_end; x += 2)
+        {
+            for (int lane = 0; lane < 4; lane++)
+            {
+                auto px = (float) x + quad_x[lane];
+                auto py = (float) y + quad_y[lane];
+
+                float edge[3];
+
+                for (int k = 0; k < 3; k++)
+                    edge[k] = a[k] * px + b[k] * py + c[k];
+
+                if (edge[0] < 0.0f || edge[1] < 0.0f || edge[2] < 0.0f)
+                    continue;
+
+                auto l0 = edge[0] * inv_area;
+                auto l1 = edge[1] * inv_area;
+                auto l2 = edge[2] * inv_area;
+
+                auto z = l0 * triangle.z[0] + l1 * triangle.z[1] + l2 * triangle.z[2];
+                auto pixel = (y + lane / 2) * _stride + x + lane % 2;
+
+                if (!(z < _depth[pixel]))
+                    continue;
+
+                _depth[pixel] = z;
+
+                auto color = is_phong ? shade(l0, l1, l2) : glm::vec3(1.0f);
+
+                // rgba bytes in memory order, alpha is always opaque
+                _color[pixel] = to_byte(color.x) | (to_byte(color.y) << 8)
+                    | (to_byte(color.z) << 16) | 0xff000000u;
+
+                fragments++;
+            }
+        }
+    }
+#endif // SOFTWARE_BACKEND_SSE
+
+    _tile_fragments[(tile_y0 / tile_size) * _tiles_x + tile_x0 / tile_size] += fragments;
+}
+
+void SoftwareBackend::save(const std::string& filename) const
+{
+    auto ok = stbi_write_png(
+        filename.c_str(), _width, _height, 4,
+        _color.data(), _stride * (int) sizeof(std::uint32_t));
+
+    if (!ok)
+    {
+        spdlog::error("failed to write image \"{}\"", filename);
+        throw std::runtime_error("failed to write image");
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <csv-model.hpp>
+#include <job-system.hpp>
+#include <render-backend.hpp>
+#include <texture.hpp>
+
+// rasterizes on the CPU into an offscreen image, for machines without a GPU.
+// triangles are transformed in parallel, binned into screen tiles and every
+// tile is rasterized and shaded by one job, four pixels (a 2x2 quad) at a
+// time with SSE
+class SoftwareBackend : public RenderBackend
+{
+public:
+    struct Stats
+    {
+        std::size_t triangles = 0;
+        std::size_t fragments = 0;
+        double seconds = 0.0;
+    };
+
+    SoftwareBackend(JobSystem& jobs, int width, int height);
+
+    const char* name() const override
+    {
+        return "software";
+    }
+
+    void draw_frame(const FrameData& frame) override;
+
+    // writes the last frame as a png
+    void save(const std::string& filename) const;
+
+    int width() const
+    {
+        return _width;
+    }
+
+    int height() const
+    {
+        return _height;
+    }
+
+    // numbers of the last frame
+    const Stats& stats() const
+    {
+        return _stats;
+    }
+
+private:
+    static constexpr int tile_size = 64;
+    static constexpr int attribute_count = 8;
+
+    // a triangle after clipping, in screen space with y pointing down
+    struct Triangle
+    {
+        float x[3];
+        float y[3];
+        float z[3];
+        float inv_w[3];
+
+        // world position, normal and texture coordinate, divided by w so they
+        // can be interpolated linearly in screen space
+        float attributes[3][attribute_count];
+
+        const Texture* texture;
+        ShadingModel shading;
+        bool valid;
+
+        int min_x;
+        int min_y;
+        int max_x;
+        int max_y;
+    };
+
+    void transform_triangles(const FrameData& frame);
+    void setup_triangle(
+        const glm::vec4 clip[3], const float* attributes[3], Triangle& out) const;
+    void bin_triangles();
+    void raster_tile(int tile, const FrameData& frame);
+    void raster_triangle(
+        const Triangle& triangle, const FrameData& frame,
+        int tile_x0, int tile_y0, int tile_x1, int tile_y1);
+
+    JobSystem& _jobs;
+
+    int _width;
+    int _height;
+
+    // the buffers are padded to even sizes so a quad never crosses the edge
+    int _stride;
+    int _padded_height;
+
+    int _tiles_x;
+    int _tiles_y;
+
+    std::vector<std::uint32_t> _color;
+    std::vector<float> _depth;
+
+    // each source triangle can turn into two after near plane clipping, so
+    // it owns two slots
+    std::vector<Triangle> _triangles;
+    std::vector<std::size_t> _command_offsets;
+    std::vector<std::vector<std::uint32_t>> _bins;
+    std::vector<std::size_t> _tile_fragments;
+
+    glm::vec3 _light_world_pos;
+
+    Stats _stats;
+};
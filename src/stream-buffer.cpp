@@ -0,0 +1,191 @@
+#include <stream-buffer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+static std::size_t align_up(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+StreamBuffer::StreamBuffer(unsigned int target, std::size_t alignment, int frames_in_flight,
+    std::size_t region_size) :
+    _target(target),
+    _alignment(alignment),
+    _frames_in_flight(frames_in_flight),
+    _persistent(GLEW_ARB_buffer_storage),
+    _fences(frames_in_flight, nullptr)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || frames_in_flight < 1)
+    {
+        spdlog::error("stream buffer needs a power of two alignment and a frame in flight, got {} and {}",
+            alignment, frames_in_flight);
+        throw std::invalid_argument("invalid stream buffer");
+    }
+
+    create(region_size);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    destroy();
+}
+
+void StreamBuffer::create(std::size_t region_size)
+{
+    // regions start aligned, so allocations are aligned to the buffer too
+    _region_size = align_up(region_size, _alignment);
+    auto size = _region_size * _frames_in_flight;
+
+    glGenBuffers(1, &_id);
+    glBindBuffer(_target, _id);
+
+    if (_persistent)
+    {
+        auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(_target, size, nullptr, flags);
+        _persistent_data = static_cast<unsigned char*>(glMapBufferRange(_target, 0, size, flags));
+    }
+    else
+    {
+        glBufferData(_target, size, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void StreamBuffer::destroy()
+{
+    for (auto& fence: _fences)
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+
+        fence = nullptr;
+    }
+
+    if (_persistent_data != nullptr || _data != nullptr)
+    {
+        glBindBuffer(_target, _id);
+        glUnmapBuffer(_target);
+    }
+
+    glDeleteBuffers(1, &_id);
+
+    _id = 0;
+    _persistent_data = nullptr;
+    _data = nullptr;
+}
+
+void StreamBuffer::wait(int region)
+{
+    auto fence = _fences[region];
+
+    if (fence == nullptr)
+        return;
+
+    auto status = glClientWaitSync(fence, 0, 0);
+
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        // the flush makes sure the fence is submitted, or waiting on it
+        // could never end
+        do
+        {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        while (status == GL_TIMEOUT_EXPIRED);
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        _stats.stalls++;
+        _stats.stall_ms += elapsed.count();
+        _stats.max_stall_ms = std::max(_stats.max_stall_ms, elapsed.count());
+    }
+
+    if (status == GL_WAIT_FAILED)
+        spdlog::error("waiting on a stream buffer fence failed");
+
+    glDeleteSync(fence);
+    _fences[region] = nullptr;
+}
+
+void StreamBuffer::begin_frame(std::size_t bytes)
+{
+    if (bytes > _region_size)
+    {
+        for (int i = 0; i < _frames_in_flight; i++)
+            wait(i);
+
+        auto region_size = _region_size;
+
+        while (region_size < bytes)
+            region_size *= 2;
+
+        destroy();
+        create(region_size);
+
+        _region = 0;
+        _stats.resizes++;
+
+        spdlog::info("stream buffer grown to {} KB per frame", _region_size / 1024);
+    }
+
+    wait(_region);
+
+    _used = 0;
+    auto offset = _region * _region_size;
+
+    if (_persistent)
+    {
+        _data = _persistent_data + offset;
+    }
+    else
+    {
+        glBindBuffer(_target, _id);
+
+        auto flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        _data = static_cast<unsigned char*>(glMapBufferRange(_target, offset, _region_size, flags));
+    }
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(std::size_t bytes)
+{
+    auto start = align_up(_used, _alignment);
+
+    if (_data == nullptr || start + bytes > _region_size)
+    {
+        spdlog::error("stream buffer allocation of {} bytes does not fit the {} bytes left of the frame",
+            bytes, _data == nullptr ? 0 : _region_size - std::min(start, _region_size));
+        throw std::logic_error("stream buffer allocation out of the frame");
+    }
+
+    _used = start + bytes;
+    _stats.peak_bytes = std::max(_stats.peak_bytes, _used);
+
+    return Allocation { _data + start, _region * _region_size + start };
+}
+
+void StreamBuffer::flush()
+{
+    // coherent mappings need no flush, and stay mapped
+    if (!_persistent && _data != nullptr)
+    {
+        glBindBuffer(_target, _id);
+        glUnmapBuffer(_target);
+    }
+
+    _data = nullptr;
+}
+
+void StreamBuffer::end_frame()
+{
+    flush();
+
+    _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _region = (_region + 1) % _frames_in_flight;
+    _stats.frames++;
+}
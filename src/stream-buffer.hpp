@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+// a buffer the CPU writes every frame and the GPU reads, split in one region
+// per frame in flight. a region is only written again once the fence of the
+// frame that last used it has passed, so the CPU only waits when it gets
+// frames_in_flight frames ahead of the GPU. with ARB_buffer_storage the
+// buffer stays mapped for good, otherwise each region is mapped
+// unsynchronized for its frame, which the fences make just as safe
+class StreamBuffer
+{
+public:
+    struct Allocation
+    {
+        void* data;
+        std::size_t offset; // from the start of the buffer
+    };
+
+    struct Stats
+    {
+        std::uint64_t frames = 0;
+
+        // frames that had to wait for the GPU to release their region
+        std::uint64_t stalls = 0;
+        double stall_ms = 0.0;
+        double max_stall_ms = 0.0;
+
+        std::size_t peak_bytes = 0; // most bytes used by a frame
+        int resizes = 0;
+    };
+
+    // allocations are aligned to alignment, which must be a power of two
+    StreamBuffer(unsigned int target, std::size_t alignment, int frames_in_flight,
+        std::size_t region_size = 64 * 1024);
+
+    StreamBuffer(const StreamBuffer& other) = delete;
+    StreamBuffer& operator = (const StreamBuffer& other) = delete;
+
+    ~StreamBuffer();
+
+    unsigned int id() const
+    {
+        return _id;
+    }
+
+    std::size_t alignment() const
+    {
+        return _alignment;
+    }
+
+    bool persistent() const
+    {
+        return _persistent;
+    }
+
+    const Stats& stats() const
+    {
+        return _stats;
+    }
+
+    // waits until the region of the next frame is free and makes it
+    // writable. the region grows to hold bytes when it is smaller, which
+    // waits for every frame in flight
+    void begin_frame(std::size_t bytes);
+
+    Allocation allocate(std::size_t bytes);
+
+    // makes the writes of the frame visible to the GPU, call before the
+    // draws reading them
+    void flush();
+
+    // fences the region after the draws reading it were submitted
+    void end_frame();
+
+private:
+    void create(std::size_t region_size);
+    void destroy();
+    void wait(int region);
+
+    unsigned int _target;
+    std::size_t _alignment;
+    int _frames_in_flight;
+    bool _persistent;
+
+    unsigned int _id = 0;
+    std::size_t _region_size = 0;
+    unsigned char* _persistent_data = nullptr;
+
+    std::vector<GLsync> _fences;
+    int _region = 0;
+
+    // the region being written, null outside begin_frame and flush
+    unsigned char* _data = nullptr;
+    std::size_t _used = 0;
+
+    Stats _stats;
+};
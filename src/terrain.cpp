@@ -0,0 +1,412 @@
+#include <terrain.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+constexpr int noise_octaves = 5;
+constexpr float noise_frequency = 0.04f;
+
+static float hash_noise(int x, int z)
+{
+    auto h = static_cast<std::uint32_t>(x) * 374761393u
+        + static_cast<std::uint32_t>(z) * 668265263u;
+
+    h = (h ^ (h >> 13)) * 1274126177u;
+    h ^= h >> 16;
+
+    return static_cast<float>(h & 0xffffff) / static_cast<float>(0xffffff);
+}
+
+static float smooth_noise(float x, float z)
+{
+    auto x_floor = std::floor(x);
+    auto z_floor = std::floor(z);
+    int ix = static_cast<int>(x_floor);
+    int iz = static_cast<int>(z_floor);
+
+    auto fx = x - x_floor;
+    auto fz = z - z_floor;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fz = fz * fz * (3.0f - 2.0f * fz);
+
+    auto top = glm::mix(hash_noise(ix, iz), hash_noise(ix + 1, iz), fx);
+    auto bottom = glm::mix(hash_noise(ix, iz + 1), hash_noise(ix + 1, iz + 1), fx);
+
+    return glm::mix(top, bottom, fz);
+}
+
+Terrain::Terrain(
+    JobSystem& jobs,
+    const TerrainSettings& settings,
+    std::shared_ptr<Texture> texture,
+    Image heightmap)
+    : _jobs(jobs)
+{
+    if (settings.chunk_size <= 0.0f || settings.chunk_resolution < 1
+        || settings.view_distance < 0 || settings.lod_levels < 1
+        || settings.lod_distance < 1 || settings.builds_per_frame < 1
+        || settings.heightmap_scale <= 0.0f || settings.texture_scale <= 0.0f)
+    {
+        spdlog::error("invalid terrain settings");
+        throw std::invalid_argument("invalid terrain settings");
+    }
+
+    _settings = settings;
+    _texture = std::move(texture);
+    _heightmap = std::move(heightmap);
+    _grid_size = 2 * settings.view_distance + 1;
+
+    auto slot_count = static_cast<std::size_t>(_grid_size * _grid_size);
+    auto vertex_floats = max_vertex_count() * CsvModel::floats_per_vertex;
+
+    // every buffer is sized for the finest level once, swapping meshes
+    // between the builds and the slots never allocates after this
+    _models.reserve(slot_count);
+
+    for (std::size_t i = 0; i < slot_count; i++)
+    {
+        CsvMesh mesh;
+        mesh.vertices.reserve(vertex_floats);
+        _models.emplace_back(std::move(mesh), _texture);
+    }
+
+    _slots.resize(slot_count);
+    _renderables.reserve(slot_count);
+
+    auto heights_size = static_cast<std::size_t>(
+        (settings.chunk_resolution + 3) * (settings.chunk_resolution + 3));
+
+    _builds = std::vector<Build>(static_cast<std::size_t>(settings.builds_per_frame) * 2);
+
+    for (auto& build: _builds)
+    {
+        build.terrain = this;
+        build.mesh.vertices.reserve(vertex_floats);
+        build.heights.reserve(heights_size);
+    }
+
+    for (int x = -settings.view_distance; x <= settings.view_distance; x++)
+    {
+        for (int z = -settings.view_distance; z <= settings.view_distance; z++)
+            _offsets.push_back(Offset { x, z, std::max(std::abs(x), std::abs(z)) });
+    }
+
+    std::stable_sort(_offsets.begin(), _offsets.end(),
+        [](const Offset& a, const Offset& b) {
+            return a.distance < b.distance;
+        });
+
+    spdlog::info("terrain: {} chunk slots of up to {} vertices",
+        slot_count, max_vertex_count());
+}
+
+Terrain::~Terrain()
+{
+    for (auto& build: _builds)
+    {
+        if (build.busy)
+            _jobs.wait(build.counter);
+    }
+}
+
+float Terrain::height(float x, float z) const
+{
+    float value;
+
+    if (_heightmap.pixels)
+    {
+        value = sample_heightmap(x, z);
+    }
+    else
+    {
+        value = 0.0f;
+        auto amplitude = 0.5f;
+        auto frequency = noise_frequency;
+
+        for (int i = 0; i < noise_octaves; i++)
+        {
+            value += amplitude * smooth_noise(x * frequency, z * frequency);
+            amplitude *= 0.5f;
+            frequency *= 2.0f;
+        }
+    }
+
+    // the highest ground sits at the base height, where objects stand
+    return _settings.base_height - _settings.height_scale * (1.0f - value);
+}
+
+float Terrain::sample_heightmap(float x, float z) const
+{
+    auto u = x / _settings.heightmap_scale;
+    auto v = z / _settings.heightmap_scale;
+
+    auto u_floor = std::floor(u);
+    auto v_floor = std::floor(v);
+    auto fu = u - u_floor;
+    auto fv = v - v_floor;
+
+    // the image repeats, so the world has no edge
+    auto wrap = [](int value, int size) {
+        value %= size;
+        return value < 0 ? value + size : value;
+    };
+
+    auto width = _heightmap.width;
+    auto height = _heightmap.height;
+    int x0 = wrap(static_cast<int>(u_floor), width);
+    int y0 = wrap(static_cast<int>(v_floor), height);
+    int x1 = wrap(x0 + 1, width);
+    int y1 = wrap(y0 + 1, height);
+
+    auto pixel = [&](int px, int py) {
+        return _heightmap.pixels.get()[(py * width + px) * _heightmap.channels] / 255.0f;
+    };
+
+    auto top = glm::mix(pixel(x0, y0), pixel(x1, y0), fu);
+    auto bottom = glm::mix(pixel(x0, y1), pixel(x1, y1), fu);
+
+    return glm::mix(top, bottom, fv);
+}
+
+int Terrain::slot_index(int x, int z) const
+{
+    auto wrap = [&](int value) {
+        value %= _grid_size;
+        return value < 0 ? value + _grid_size : value;
+    };
+
+    return wrap(x) * _grid_size + wrap(z);
+}
+
+int Terrain::lod_for(int distance) const
+{
+    return std::min(distance / _settings.lod_distance, _settings.lod_levels - 1);
+}
+
+int Terrain::resolution_for(int lod) const
+{
+    return std::max(_settings.chunk_resolution >> lod, 1);
+}
+
+std::size_t Terrain::max_vertex_count() const
+{
+    // two triangles per quad plus a skirt quad along every edge segment
+    auto n = static_cast<std::size_t>(_settings.chunk_resolution);
+    return 6 * n * n + 4 * 6 * n;
+}
+
+void Terrain::update(const glm::vec3& camera_pos)
+{
+    int center_x = static_cast<int>(std::floor(camera_pos.x / _settings.chunk_size));
+    int center_z = static_cast<int>(std::floor(camera_pos.z / _settings.chunk_size));
+
+    finish_builds(false);
+    start_builds(center_x, center_z, _settings.builds_per_frame);
+    collect_renderables(center_x, center_z);
+}
+
+void Terrain::build_all(const glm::vec3& camera_pos)
+{
+    int center_x = static_cast<int>(std::floor(camera_pos.x / _settings.chunk_size));
+    int center_z = static_cast<int>(std::floor(camera_pos.z / _settings.chunk_size));
+
+    // the builds are a small pool, so the chunks go in rounds of as many as
+    // it holds until every slot has the chunk it should
+    do
+    {
+        finish_builds(true);
+    }
+    while (start_builds(center_x, center_z, static_cast<int>(_builds.size())) > 0);
+
+    collect_renderables(center_x, center_z);
+}
+
+void Terrain::finish_builds(bool wait)
+{
+    for (auto& build: _builds)
+    {
+        if (!build.busy)
+            continue;
+
+        if (wait)
+            _jobs.wait(build.counter);
+        else if (!build.counter.done())
+            continue;
+
+        auto& slot = _slots[build.slot];
+        _models[build.slot].swap_mesh(build.mesh);
+
+        slot.x = build.x;
+        slot.z = build.z;
+        slot.lod = build.lod;
+        slot.ready = true;
+        slot.building = false;
+
+        build.busy = false;
+    }
+}
+
+int Terrain::start_builds(int center_x, int center_z, int limit)
+{
+    int started = 0;
+    auto free_build = _builds.begin();
+
+    for (auto& offset: _offsets)
+    {
+        if (started == limit)
+            break;
+
+        auto x = center_x + offset.x;
+        auto z = center_z + offset.z;
+        auto lod = lod_for(offset.distance);
+        auto index = slot_index(x, z);
+        auto& slot = _slots[index];
+
+        if (slot.building)
+            continue;
+
+        if (slot.ready && slot.x == x && slot.z == z && slot.lod == lod)
+            continue;
+
+        free_build = std::find_if(free_build, _builds.end(),
+            [](const Build& build) { return !build.busy; });
+
+        if (free_build == _builds.end())
+            break;
+
+        // a slot taken over by another chunk stops drawing the old one,
+        // a slot only changing detail keeps it until the new one is ready
+        if (slot.x != x || slot.z != z)
+            slot.ready = false;
+
+        slot.building = true;
+
+        auto& build = *free_build;
+        build.busy = true;
+        build.slot = index;
+        build.x = x;
+        build.z = z;
+        build.lod = lod;
+
+        Job job;
+        job.function = &Terrain::run_build;
+        job.data = &build;
+        _jobs.run(job, build.counter);
+
+        started++;
+    }
+
+    return started;
+}
+
+void Terrain::collect_renderables(int center_x, int center_z)
+{
+    _renderables.clear();
+
+    for (std::size_t i = 0; i < _slots.size(); i++)
+    {
+        auto& slot = _slots[i];
+
+        // slots are only rebuilt a few at a time, so some can still hold a
+        // chunk the camera left behind
+        auto distance = std::max(std::abs(slot.x - center_x), std::abs(slot.z - center_z));
+
+        if (slot.ready && distance <= _settings.view_distance)
+            _renderables.push_back(Renderable { no_entity, &_models[i], ShadingModel::phong });
+    }
+}
+
+void Terrain::run_build(void* data, std::size_t begin, std::size_t end)
+{
+    auto build = static_cast<Build*>(data);
+    build->terrain->build_chunk(*build);
+}
+
+void Terrain::build_chunk(Build& build) const
+{
+    auto n = resolution_for(build.lod);
+    auto step = _settings.chunk_size / n;
+    auto origin_x = build.x * _settings.chunk_size;
+    auto origin_z = build.z * _settings.chunk_size;
+
+    // heights with a one sample border, for the normals along the edges
+    auto row = n + 3;
+    auto& heights = build.heights;
+    heights.resize(static_cast<std::size_t>(row * row));
+
+    for (int i = 0; i < row; i++)
+    {
+        for (int j = 0; j < row; j++)
+            heights[i * row + j] = height(origin_x + (i - 1) * step, origin_z + (j - 1) * step);
+    }
+
+    auto& vertices = build.mesh.vertices;
+    vertices.clear();
+
+    auto& bounds = build.mesh.bounds;
+    bounds.min = glm::vec3(origin_x, heights[0], origin_z);
+    bounds.max = bounds.min;
+
+    auto skirt_depth = _settings.height_scale * 0.25f + step;
+
+    // i and j index grid points along x and z, drop lowers the vertex for
+    // the skirts hiding the cracks between levels of detail
+    auto emit = [&](int i, int j, float drop) {
+        auto h = heights[(i + 1) * row + (j + 1)];
+        glm::vec3 position(origin_x + i * step, h - drop, origin_z + j * step);
+
+        auto normal = glm::normalize(glm::vec3(
+            heights[i * row + (j + 1)] - heights[(i + 2) * row + (j + 1)],
+            2.0f * step,
+            heights[(i + 1) * row + j] - heights[(i + 1) * row + (j + 2)]));
+
+        const float vertex[CsvModel::floats_per_vertex] =
+        {
+            position.x, position.y, position.z,
+            1.0f, 1.0f, 1.0f,
+            position.x / _settings.texture_scale, position.z / _settings.texture_scale,
+            normal.x, normal.y, normal.z
+        };
+
+        vertices.insert(vertices.end(), vertex, vertex + CsvModel::floats_per_vertex);
+
+        bounds.min = glm::min(bounds.min, position);
+        bounds.max = glm::max(bounds.max, position);
+    };
+
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            emit(i, j, 0.0f);
+            emit(i, j + 1, 0.0f);
+            emit(i + 1, j + 1, 0.0f);
+
+            emit(i + 1, j + 1, 0.0f);
+            emit(i + 1, j, 0.0f);
+            emit(i, j, 0.0f);
+        }
+    }
+
+    auto skirt = [&](int i0, int j0, int i1, int j1) {
+        emit(i0, j0, 0.0f);
+        emit(i1, j1, 0.0f);
+        emit(i1, j1, skirt_depth);
+
+        emit(i1, j1, skirt_depth);
+        emit(i0, j0, skirt_depth);
+        emit(i0, j0, 0.0f);
+    };
+
+    for (int k = 0; k < n; k++)
+    {
+        skirt(k, 0, k + 1, 0);
+        skirt(k, n, k + 1, n);
+        skirt(0, k, 0, k + 1);
+        skirt(n, k, n, k + 1);
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <csv-model.hpp>
+#include <draw-list.hpp>
+#include <job-system.hpp>
+#include <settings.hpp>
+#include <texture.hpp>
+
+// ground built from a heightmap in square chunks around the camera. every
+// chunk coordinate maps to a fixed slot of a grid that wraps around like a
+// clipmap, so the memory used never depends on how far the camera goes.
+// chunks further away get fewer vertices, and chunks are rebuilt on the job
+// system a few per frame while the slots keep drawing what they had
+class Terrain
+{
+public:
+    // heightmap may be empty, then the heights come from noise
+    Terrain(
+        JobSystem& jobs,
+        const TerrainSettings& settings,
+        std::shared_ptr<Texture> texture,
+        Image heightmap);
+
+    Terrain(const Terrain& other) = delete;
+    Terrain& operator = (const Terrain& other) = delete;
+
+    ~Terrain();
+
+    // height of the ground at a world position, safe to call from any thread
+    float height(float x, float z) const;
+
+    // swaps in the chunks that finished building and schedules the ones the
+    // camera needs now. runs on the render thread, before the draw list
+    void update(const glm::vec3& camera_pos);
+
+    // builds every chunk the camera needs and waits for them, for when the
+    // frame cannot show the ground coming in, like the first one or the
+    // offline renders
+    void build_all(const glm::vec3& camera_pos);
+
+    // the chunks ready to draw, their vertices are in world space
+    const std::vector<Renderable>& renderables() const
+    {
+        return _renderables;
+    }
+
+    std::size_t slot_count() const
+    {
+        return _slots.size();
+    }
+
+private:
+    struct Slot
+    {
+        int x = 0;
+        int z = 0;
+        int lod = 0;
+
+        // the model holds the chunk above
+        bool ready = false;
+        bool building = false;
+    };
+
+    struct Build
+    {
+        const Terrain* terrain = nullptr;
+        JobCounter counter;
+        bool busy = false;
+
+        int slot = 0;
+        int x = 0;
+        int z = 0;
+        int lod = 0;
+
+        CsvMesh mesh;
+        std::vector<float> heights;
+    };
+
+    struct Offset
+    {
+        int x;
+        int z;
+        int distance;
+    };
+
+    static void run_build(void* data, std::size_t begin, std::size_t end);
+
+    // moves the meshes of the finished builds into their slots, waiting for
+    // the ones still running when wait is set
+    void finish_builds(bool wait);
+
+    // starts up to limit builds of the chunks around the center chunk,
+    // returns how many it started
+    int start_builds(int center_x, int center_z, int limit);
+
+    void collect_renderables(int center_x, int center_z);
+
+    void build_chunk(Build& build) const;
+    float sample_heightmap(float x, float z) const;
+
+    int slot_index(int x, int z) const;
+    int lod_for(int distance) const;
+    int resolution_for(int lod) const;
+    std::size_t max_vertex_count() const;
+
+    JobSystem& _jobs;
+    TerrainSettings _settings;
+    std::shared_ptr<Texture> _texture;
+    Image _heightmap;
+
+    // slots per side, twice the view distance plus the camera chunk
+    int _grid_size;
+
+    std::vector<CsvModel> _models;
+    std::vector<Slot> _slots;
+    std::vector<Build> _builds;
+
+    // every chunk offset in view, nearest first
+    std::vector<Offset> _offsets;
+
+    std::vector<Renderable> _renderables;
+};
@@ -0,0 +1,355 @@
+#include <texture-streamer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <limits>
+
+#include <spdlog/spdlog.h>
+
+#include <allocation-tracker.hpp>
+#include <cooked-assets.hpp>
+
+// drivers store RGB8 textures as RGBA8
+constexpr std::size_t bytes_per_texel = 4;
+
+static std::size_t level_bytes(const MipSource& source, int level)
+{
+    auto width = std::max(source.width >> level, 1);
+    auto height = std::max(source.height >> level, 1);
+
+    return std::size_t(width) * height * bytes_per_texel;
+}
+
+// levels first to last - 1
+static std::size_t levels_bytes(const MipSource& source, int first, int last)
+{
+    std::size_t bytes = 0;
+
+    for (auto level = first; level < last; level++)
+        bytes += level_bytes(source, level);
+
+    return bytes;
+}
+
+float screen_size(
+    const Bounds& bounds, const glm::mat4& world,
+    const glm::mat4& view, const glm::mat4& projection, int viewport_height)
+{
+    auto center = glm::vec3(world * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+
+    auto scale = std::max(
+        std::max(glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1]))),
+        glm::length(glm::vec3(world[2])));
+
+    auto radius = glm::length(bounds.max - bounds.min) * 0.5f * scale;
+
+    // distance to the nearest point of the sphere, inside it the texture
+    // needs every level
+    auto depth = -(view * glm::vec4(center, 1.0f)).z - radius;
+
+    if (depth <= 0.0f)
+        return std::numeric_limits<float>::max();
+
+    return radius * projection[1][1] * viewport_height / depth;
+}
+
+TextureStreamer::TextureStreamer(JobSystem& jobs, const TextureStreamingSettings& settings) :
+    _jobs(jobs),
+    _settings(settings),
+    _budget_bytes(std::size_t(settings.budget_mb) * 1024 * 1024),
+    _loads(settings.loads_per_frame)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    for (auto& load: _loads)
+    {
+        if (load.busy)
+            _jobs.wait(load.counter);
+    }
+}
+
+int TextureStreamer::wanted_level(const MipSource& source, float screen_size) const
+{
+    if (screen_size <= 0.0f)
+        return source.level;
+
+    auto texels = (float) std::max(source.width, source.height);
+    auto level = std::floor(std::log2(texels / screen_size) + _settings.mip_bias);
+
+    return static_cast<int>(std::min(std::max(level, 0.0f), (float) source.level));
+}
+
+// the finest level the entry needs now, unused textures only need the level
+// they were created with
+int TextureStreamer::keep_level(const Entry& entry) const
+{
+    if (entry.last_used == _frame)
+        return entry.wanted_level;
+
+    return entry.texture->mip_source().level;
+}
+
+bool TextureStreamer::fits(std::size_t bytes) const
+{
+    return _resident_bytes + _loading_bytes + bytes <= _budget_bytes;
+}
+
+void TextureStreamer::request(const Texture& texture, float screen_size)
+{
+    if (!texture.streamed())
+        return;
+
+    auto& source = texture.mip_source();
+    auto it = _entries.find(&texture);
+
+    if (it == _entries.end())
+    {
+        Entry entry;
+        entry.texture = &texture;
+        entry.resident_level = source.level;
+        entry.wanted_level = source.level;
+
+        it = _entries.emplace(&texture, entry).first;
+    }
+
+    auto& entry = it->second;
+
+    if (entry.last_used != _frame)
+    {
+        entry.last_used = _frame;
+        entry.wanted_level = source.level;
+    }
+
+    entry.wanted_level = std::min(entry.wanted_level, wanted_level(source, screen_size));
+}
+
+const std::vector<MipUpdate>& TextureStreamer::update()
+{
+    // the reads it starts are charged here too, through their jobs
+    AllocationScope scope(AllocationTag::textures);
+
+    _updates.clear();
+
+    finish_loads();
+    evict(0);
+    start_loads();
+
+    _frame++;
+    return _updates;
+}
+
+void TextureStreamer::release(const Texture& texture)
+{
+    auto it = _entries.find(&texture);
+
+    if (it == _entries.end())
+        return;
+
+    auto& entry = it->second;
+
+    if (entry.load >= 0)
+    {
+        auto& load = _loads[entry.load];
+        _loading_bytes -= load.bytes;
+
+        load.texture = nullptr;
+        load.bytes = 0;
+    }
+
+    auto& source = texture.mip_source();
+    _resident_bytes -= levels_bytes(source, entry.resident_level, source.level);
+    _entries.erase(it);
+}
+
+std::vector<TextureResidency> TextureStreamer::residency() const
+{
+    std::vector<TextureResidency> residency;
+
+    for (auto& item: _entries)
+    {
+        auto& entry = item.second;
+        auto& source = entry.texture->mip_source();
+
+        residency.push_back(TextureResidency {
+            entry.texture,
+            source.filename,
+            source.levels,
+            entry.resident_level,
+            entry.wanted_level,
+            _frame - entry.last_used,
+            entry.load >= 0,
+            levels_bytes(source, entry.resident_level, source.levels),
+            entry.loads,
+            entry.evictions });
+    }
+
+    return residency;
+}
+
+void TextureStreamer::run_load(void* data, std::size_t begin, std::size_t end)
+{
+    auto& load = *static_cast<Load*>(data);
+
+    try
+    {
+        load.images = read_cooked_mips(load.filename, load.first, load.count);
+    }
+    catch (const std::exception& error)
+    {
+        spdlog::error("could not stream \"{}\": {}", load.filename, error.what());
+        load.failed = true;
+    }
+}
+
+void TextureStreamer::finish_loads()
+{
+    for (auto& load: _loads)
+    {
+        if (!load.busy || !load.counter.done())
+            continue;
+
+        load.busy = false;
+        _loading_bytes -= load.bytes;
+
+        auto images = std::move(load.images);
+        load.images.clear();
+
+        if (load.texture == nullptr)
+            continue;
+
+        auto& entry = _entries.at(load.texture);
+        entry.load = -1;
+
+        // a texture that failed once stays at the levels it has
+        if (load.failed)
+        {
+            entry.failed = true;
+            continue;
+        }
+
+        _resident_bytes += load.bytes;
+        entry.loads++;
+
+        _updates.push_back(MipUpdate {
+            load.texture, entry.resident_level, load.first, std::move(images) });
+
+        entry.resident_level = load.first;
+    }
+}
+
+// drops the levels the textures do not need now, least recently used first,
+// until bytes more fit in the budget. drops nothing when that is not enough
+bool TextureStreamer::evict(std::size_t bytes)
+{
+    if (fits(bytes))
+        return true;
+
+    _eviction_order.clear();
+    std::size_t evictable = 0;
+
+    for (auto& item: _entries)
+    {
+        auto& entry = item.second;
+        auto level = keep_level(entry);
+
+        // textures being read keep their levels until the read lands
+        if (entry.load < 0 && entry.resident_level < level)
+        {
+            _eviction_order.push_back(&entry);
+            evictable += levels_bytes(entry.texture->mip_source(), entry.resident_level, level);
+        }
+    }
+
+    if (_resident_bytes + _loading_bytes + bytes > _budget_bytes + evictable)
+        return false;
+
+    std::sort(_eviction_order.begin(), _eviction_order.end(), [](const Entry* a, const Entry* b) {
+        return a->last_used < b->last_used;
+    });
+
+    for (auto entry: _eviction_order)
+    {
+        drop(*entry, keep_level(*entry));
+
+        if (fits(bytes))
+            return true;
+    }
+
+    return false;
+}
+
+void TextureStreamer::drop(Entry& entry, int level)
+{
+    auto& source = entry.texture->mip_source();
+    _resident_bytes -= levels_bytes(source, entry.resident_level, level);
+    entry.evictions++;
+
+    _updates.push_back(MipUpdate { entry.texture, entry.resident_level, level, {} });
+    entry.resident_level = level;
+}
+
+void TextureStreamer::start_loads()
+{
+    _load_order.clear();
+
+    for (auto& item: _entries)
+    {
+        auto& entry = item.second;
+
+        if (entry.last_used == _frame && entry.load < 0 && !entry.failed &&
+            entry.wanted_level < entry.resident_level)
+        {
+            _load_order.push_back(&entry);
+        }
+    }
+
+    // the textures furthest from the levels they need go first
+    std::sort(_load_order.begin(), _load_order.end(), [](const Entry* a, const Entry* b) {
+        return a->resident_level - a->wanted_level > b->resident_level - b->wanted_level;
+    });
+
+    auto next_load = _loads.begin();
+
+    for (auto entry: _load_order)
+    {
+        next_load = std::find_if(next_load, _loads.end(), [](const Load& load) {
+            return !load.busy;
+        });
+
+        if (next_load == _loads.end())
+            break;
+
+        auto& source = entry->texture->mip_source();
+
+        // when the budget is full the texture gets the finest levels that
+        // still fit, if any
+        auto first = entry->wanted_level;
+        auto last = entry->resident_level;
+
+        while (first < last && !evict(levels_bytes(source, first, last)))
+            first++;
+
+        if (first == last)
+            continue;
+
+        auto& load = *next_load;
+        load.busy = true;
+        load.texture = entry->texture;
+        load.filename = source.filename;
+        load.first = first;
+        load.count = last - first;
+        load.bytes = levels_bytes(source, first, last);
+        load.failed = false;
+
+        entry->load = static_cast<int>(next_load - _loads.begin());
+        _loading_bytes += load.bytes;
+
+        Job job;
+        job.function = &TextureStreamer::run_load;
+        job.data = &load;
+        _jobs.run(job, load.counter);
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <job-system.hpp>
+#include <settings.hpp>
+#include <texture.hpp>
+#include <transform.hpp>
+
+// a change of the levels a backend has of a streamed texture. the texture
+// goes from previous_level to level as its finest level, with the images of
+// levels level to previous_level - 1 when it gains levels and none when it
+// drops them
+struct MipUpdate
+{
+    const Texture* texture;
+    int previous_level;
+    int level;
+    std::vector<Image> images;
+};
+
+struct TextureResidency
+{
+    const Texture* texture;
+    std::string filename;
+    int levels;
+    int resident_level;
+
+    // what the last frame that drew it needed
+    int wanted_level;
+    std::uint64_t frames_since_used;
+
+    bool loading;
+    std::size_t resident_bytes; // of every level, the coarse ones included
+    int loads;
+    int evictions;
+};
+
+// how many pixels across the bounds cover on screen, from their bounding
+// sphere. used as the size of the texture on screen, so it assumes the
+// texture is mapped once over the model
+float screen_size(
+    const Bounds& bounds, const glm::mat4& world,
+    const glm::mat4& view, const glm::mat4& projection, int viewport_height);
+
+// decides which levels of the streamed textures are resident. backends
+// request every streamed texture they draw with its size on screen, then
+// apply the updates once per frame. finer levels are read on the workers and
+// the least recently used textures drop theirs when the budget is full. the
+// level each texture was created with is never dropped, and only the levels
+// finer than it count against the budget
+class TextureStreamer
+{
+public:
+    TextureStreamer(JobSystem& jobs, const TextureStreamingSettings& settings);
+
+    TextureStreamer(const TextureStreamer& other) = delete;
+    TextureStreamer& operator = (const TextureStreamer& other) = delete;
+
+    ~TextureStreamer();
+
+    // a draw of the texture covering screen_size pixels this frame
+    void request(const Texture& texture, float screen_size);
+
+    // finishes the reads that are done, evicts down to the budget and starts
+    // new reads. call once per frame after the requests, the updates are
+    // valid until the next call
+    const std::vector<MipUpdate>& update();
+
+    // forgets the texture, called before it is destroyed
+    void release(const Texture& texture);
+
+    std::vector<TextureResidency> residency() const;
+
+    std::size_t resident_bytes() const
+    {
+        return _resident_bytes;
+    }
+
+    std::size_t budget_bytes() const
+    {
+        return _budget_bytes;
+    }
+
+private:
+    struct Entry
+    {
+        const Texture* texture;
+        int resident_level;
+
+        // finest level the draws of the last frame it was used need
+        int wanted_level;
+        std::uint64_t last_used = 0;
+
+        // slot of the read in flight, -1 when there is none
+        int load = -1;
+        bool failed = false;
+
+        int loads = 0;
+        int evictions = 0;
+    };
+
+    struct Load
+    {
+        JobCounter counter;
+        bool busy = false;
+
+        // null when the texture was released while reading
+        const Texture* texture = nullptr;
+        std::string filename;
+        int first = 0;
+        int count = 0;
+        std::size_t bytes = 0;
+
+        std::vector<Image> images;
+        bool failed = false;
+    };
+
+    static void run_load(void* data, std::size_t begin, std::size_t end);
+
+    int wanted_level(const MipSource& source, float screen_size) const;
+    int keep_level(const Entry& entry) const;
+    bool fits(std::size_t bytes) const;
+
+    void finish_loads();
+    bool evict(std::size_t bytes);
+    void drop(Entry& entry, int level);
+    void start_loads();
+
+    JobSystem& _jobs;
+    TextureStreamingSettings _settings;
+    std::size_t _budget_bytes;
+
+    std::unordered_map<const Texture*, Entry> _entries;
+    std::vector<Load> _loads;
+
+    std::size_t _resident_bytes = 0;
+    std::size_t _loading_bytes = 0;
+    std::uint64_t _frame = 1;
+
+    // kept between frames, so a steady scene does not allocate
+    std::vector<MipUpdate> _updates;
+    std::vector<Entry*> _eviction_order;
+    std::vector<Entry*> _load_order;
+};
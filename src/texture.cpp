@@ -1,25 +1,24 @@
 #include <texture.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
 #define STB_IMAGE_IMPLEMENTATION
 
-#include <GL/glew.h>
 #include <spdlog/spdlog.h>
 #include <stb_image.h>
 
-Texture::Texture(const std::string& filename)
+Image load_image(const std::string& filename)
 {
-    glGenTextures(1, &_id);
-    glBindTexture(GL_TEXTURE_2D, _id);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    Image image;
 
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    auto data = stbi_load(filename.c_str(), &width, &height, &nrChannels, 0);
+    // the flag is global to stb, so it is set once instead of racing
+    // between decoding threads
+    static const bool flip_on_load = (stbi_set_flip_vertically_on_load(true), true);
+    (void) flip_on_load;
+    auto data = stbi_load(
+        filename.c_str(), &image.width, &image.height, &image.channels, 0);
 
     if (data == nullptr)
     {
@@ -27,17 +26,78 @@ Texture::Texture(const std::string& filename)
         throw std::logic_error("failed to load texture");
     }
 
-    auto tp = nrChannels == 3 ? GL_RGB : GL_RGBA;
+    image.pixels = std::unique_ptr<unsigned char, void (*)(void*)>(
+        data, stbi_image_free);
+
+    return image;
+}
+
+Image downsample(const Image& image)
+{
+    Image half;
+    half.width = std::max(image.width / 2, 1);
+    half.height = std::max(image.height / 2, 1);
+    half.channels = image.channels;
+
+    auto size = std::size_t(half.width) * half.height * half.channels;
+    half.pixels = { static_cast<unsigned char*>(std::malloc(size)), std::free };
+
+    auto source = image.pixels.get();
+    auto target = half.pixels.get();
+    auto stride = std::size_t(image.width) * image.channels;
+
+    for (int y = 0; y < half.height; y++)
+    {
+        // odd sizes repeat the last row or column instead of reading past it
+        auto y0 = std::min(y * 2, image.height - 1);
+        auto y1 = std::min(y * 2 + 1, image.height - 1);
+
+        for (int x = 0; x < half.width; x++)
+        {
+            auto x0 = std::min(x * 2, image.width - 1);
+            auto x1 = std::min(x * 2 + 1, image.width - 1);
+
+            for (int c = 0; c < image.channels; c++)
+            {
+                auto sum =
+                    source[y0 * stride + x0 * image.channels + c] +
+                    source[y0 * stride + x1 * image.channels + c] +
+                    source[y1 * stride + x0 * image.channels + c] +
+                    source[y1 * stride + x1 * image.channels + c];
+
+                *target++ = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    }
+
+    return half;
+}
+
+int mip_levels(int width, int height)
+{
+    auto levels = 1;
+
+    for (auto size = std::max(width, height); size > 1; size /= 2)
+        levels++;
+
+    return levels;
+}
+
+Texture::Texture(const std::string& filename)
+    : Texture(load_image(filename))
+{
+}
+
+Texture::Texture(Image image)
+{
+    static std::atomic<unsigned int> next_id { 1 };
 
-    glTexImage2D(
-        GL_TEXTURE_2D, 0, tp, width, height,
-        0, tp, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    _image = std::move(image);
+    _id = next_id++;
 }
 
-void Texture::bind(int unit)
+Texture::Texture(Image image, MipSource source)
+    : Texture(std::move(image))
 {
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, _id);
+    _source = std::move(source);
 }
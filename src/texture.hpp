@@ -1,14 +1,74 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
+// decoded pixels, rows start at the bottom of the image like OpenGL expects
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::unique_ptr<unsigned char, void (*)(void*)> pixels { nullptr, nullptr };
+};
+
+// only decodes the file, so it is safe to call from any thread
+Image load_image(const std::string& filename);
+
+// the next level of the mip chain, half the size on each axis with every
+// texel the average of the 2x2 texels it covers
+Image downsample(const Image& image);
+
+// levels of a full mip chain for the size, down to 1x1
+int mip_levels(int width, int height);
+
+// where a streamed texture reads the levels finer than its image
+struct MipSource
+{
+    std::string filename;
+    int level = 0; // level of the file the image of the texture is
+    int levels = 1;
+
+    // of level 0
+    int width = 0;
+    int height = 0;
+};
+
+// an image used as a texture. it only holds CPU data, render backends create
+// their own resources from it
 class Texture
 {
 public:
     explicit Texture(const std::string& filename);
+    explicit Texture(Image image);
+
+    // a texture streamed from the file of the source, which only keeps one
+    // of the coarse levels in memory
+    Texture(Image image, MipSource source);
+
+    const Image& image() const
+    {
+        return _image;
+    }
+
+    bool streamed() const
+    {
+        return !_source.filename.empty();
+    }
+
+    const MipSource& mip_source() const
+    {
+        return _source;
+    }
 
-    void bind(int unit);
+    // unique for every texture, used to group draws sharing a texture
+    unsigned int id() const
+    {
+        return _id;
+    }
 
 private:
+    Image _image;
+    MipSource _source;
     unsigned int _id;
 };
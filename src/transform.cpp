@@ -0,0 +1,179 @@
+#include <transform.hpp>
+
+#include <cmath>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TRANSFORM_SSE
+#include <xmmintrin.h>
+#endif
+
+Bounds transform_bounds(const glm::mat4& matrix, const Bounds& local)
+{
+    auto center = (local.min + local.max) * 0.5f;
+    auto extent = (local.max - local.min) * 0.5f;
+
+    auto world_center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    glm::vec3 world_extent(0.0f);
+
+    for (int col = 0; col < 3; col++)
+        for (int row = 0; row < 3; row++)
+            world_extent[row] += std::fabs(matrix[col][row]) * extent[col];
+
+    return Bounds { world_center - world_extent, world_center + world_extent };
+}
+
+static void compose_transform(
+    float px, float py, float pz,
+    float qx, float qy, float qz, float qw,
+    float sx, float sy, float sz,
+    glm::mat4& out)
+{
+    auto m = glm::value_ptr(out);
+
+    m[0] = (1.0f - 2.0f * (qy * qy + qz * qz)) * sx;
+    m[1] = 2.0f * (qx * qy + qw * qz) * sx;
+    m[2] = 2.0f * (qx * qz - qw * qy) * sx;
+    m[3] = 0.0f;
+
+    m[4] = 2.0f * (qx * qy - qw * qz) * sy;
+    m[5] = (1.0f - 2.0f * (qx * qx + qz * qz)) * sy;
+    m[6] = 2.0f * (qy * qz + qw * qx) * sy;
+    m[7] = 0.0f;
+
+    m[8] = 2.0f * (qx * qz + qw * qy) * sz;
+    m[9] = 2.0f * (qy * qz - qw * qx) * sz;
+    m[10] = (1.0f - 2.0f * (qx * qx + qy * qy)) * sz;
+    m[11] = 0.0f;
+
+    m[12] = px;
+    m[13] = py;
+    m[14] = pz;
+    m[15] = 1.0f;
+}
+
+void compose_transforms(
+    std::size_t count,
+    const float* px, const float* py, const float* pz,
+    const float* qx, const float* qy, const float* qz, const float* qw,
+    const float* sx, const float* sy, const float* sz,
+    glm::mat4* out)
+{
+    std::size_t i = 0;
+
+#ifdef TRANSFORM_SSE
+    const auto one = _mm_set1_ps(1.0f);
+    const auto two = _mm_set1_ps(2.0f);
+    const auto zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4)
+    {
+        auto x = _mm_loadu_ps(qx + i);
+        auto y = _mm_loadu_ps(qy + i);
+        auto z = _mm_loadu_ps(qz + i);
+        auto w = _mm_loadu_ps(qw + i);
+
+        auto xx = _mm_mul_ps(x, x);
+        auto yy = _mm_mul_ps(y, y);
+        auto zz = _mm_mul_ps(z, z);
+        auto xy = _mm_mul_ps(x, y);
+        auto xz = _mm_mul_ps(x, z);
+        auto yz = _mm_mul_ps(y, z);
+        auto wx = _mm_mul_ps(w, x);
+        auto wy = _mm_mul_ps(w, y);
+        auto wz = _mm_mul_ps(w, z);
+
+        auto scale_x = _mm_loadu_ps(sx + i);
+        auto scale_y = _mm_loadu_ps(sy + i);
+        auto scale_z = _mm_loadu_ps(sz + i);
+
+        // one register per matrix element, one lane per entity
+        auto m00 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scale_x);
+        auto m01 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scale_x);
+        auto m02 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scale_x);
+
+        auto m10 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scale_y);
+        auto m11 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scale_y);
+        auto m12 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scale_y);
+
+        auto m20 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scale_z);
+        auto m21 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scale_z);
+        auto m22 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scale_z);
+
+        auto m30 = _mm_loadu_ps(px + i);
+        auto m31 = _mm_loadu_ps(py + i);
+        auto m32 = _mm_loadu_ps(pz + i);
+        auto m33 = one;
+
+        // transposing turns the element registers back into matrix columns
+        auto c00 = zero;
+        _MM_TRANSPOSE4_PS(m00, m01, m02, c00);
+        auto c10 = zero;
+        _MM_TRANSPOSE4_PS(m10, m11, m12, c10);
+        auto c20 = zero;
+        _MM_TRANSPOSE4_PS(m20, m21, m22, c20);
+        _MM_TRANSPOSE4_PS(m30, m31, m32, m33);
+
+        float* m = glm::value_ptr(out[i]);
+        _mm_storeu_ps(m, m00);
+        _mm_storeu_ps(m + 4, m10);
+        _mm_storeu_ps(m + 8, m20);
+        _mm_storeu_ps(m + 12, m30);
+
+        m = glm::value_ptr(out[i + 1]);
+        _mm_storeu_ps(m, m01);
+        _mm_storeu_ps(m + 4, m11);
+        _mm_storeu_ps(m + 8, m21);
+        _mm_storeu_ps(m + 12, m31);
+
+        m = glm::value_ptr(out[i + 2]);
+        _mm_storeu_ps(m, m02);
+        _mm_storeu_ps(m + 4, m12);
+        _mm_storeu_ps(m + 8, m22);
+        _mm_storeu_ps(m + 12, m32);
+
+        m = glm::value_ptr(out[i + 3]);
+        _mm_storeu_ps(m, c00);
+        _mm_storeu_ps(m + 4, c10);
+        _mm_storeu_ps(m + 8, c20);
+        _mm_storeu_ps(m + 12, m33);
+    }
+#endif // TRANSFORM_SSE
+
+    for (; i < count; i++)
+    {
+        compose_transform(
+            px[i], py[i], pz[i],
+            qx[i], qy[i], qz[i], qw[i],
+            sx[i], sy[i], sz[i],
+            out[i]);
+    }
+}
+
+void multiply_transform(
+    const glm::mat4& parent, const glm::mat4& local, glm::mat4& out)
+{
+#ifdef TRANSFORM_SSE
+    auto p = glm::value_ptr(parent);
+    auto l = glm::value_ptr(local);
+    auto o = glm::value_ptr(out);
+
+    auto p0 = _mm_loadu_ps(p);
+    auto p1 = _mm_loadu_ps(p + 4);
+    auto p2 = _mm_loadu_ps(p + 8);
+    auto p3 = _mm_loadu_ps(p + 12);
+
+    for (int col = 0; col < 4; col++)
+    {
+        auto c = l + col * 4;
+        auto r = _mm_mul_ps(p0, _mm_set1_ps(c[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(p1, _mm_set1_ps(c[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(p2, _mm_set1_ps(c[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(p3, _mm_set1_ps(c[3])));
+        _mm_storeu_ps(o + col * 4, r);
+    }
+#else
+    out = parent * local;
+#endif // TRANSFORM_SSE
+}
@@ -1 +1,27 @@
 #pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+};
+
+// world space box enclosing the local box transformed by matrix
+Bounds transform_bounds(const glm::mat4& matrix, const Bounds& local);
+
+// builds count local matrices out of the structure-of-arrays translation,
+// rotation (quaternion) and scale components, four at a time with SSE
+void compose_transforms(
+    std::size_t count,
+    const float* px, const float* py, const float* pz,
+    const float* qx, const float* qy, const float* qz, const float* qw,
+    const float* sx, const float* sy, const float* sz,
+    glm::mat4* out);
+
+// out = parent * local
+void multiply_transform(
+    const glm::mat4& parent, const glm::mat4& local, glm::mat4& out);